@@ -0,0 +1,107 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+#include "ClassWhitelistCache.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+
+#include <detectionComponentUtils.h>
+#include <MPFDetectionException.h>
+#include <MPFInvalidPropertyException.h>
+#include <Utils.h>
+
+
+using namespace MPF::COMPONENT;
+
+
+std::shared_ptr<const ClassWhitelist> ClassWhitelistCache::Get(const Properties &job_properties) {
+    std::string whitelist_path = DetectionComponentUtils::GetProperty(
+            job_properties, "CLASS_WHITELIST_FILE", std::string());
+    if (whitelist_path.empty()) {
+        return nullptr;
+    }
+
+    std::string expanded_file_path;
+    std::string error = Utils::expandFileName(whitelist_path, expanded_file_path);
+    if (!error.empty()) {
+        throw MPFInvalidPropertyException(
+                "CLASS_WHITELIST_FILE",
+                "The value, \"" + whitelist_path + "\", could not be expanded due to: " + error);
+    }
+
+    struct stat file_status;
+    time_t mod_time = stat(expanded_file_path.c_str(), &file_status) == 0 ? file_status.st_mtime : 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto entry_iter = entries_.find(expanded_file_path);
+        if (entry_iter != entries_.end() && entry_iter->second.mod_time == mod_time) {
+            return entry_iter->second.class_names;
+        }
+    }
+
+    // The file is parsed without holding the lock so that jobs using other whitelist files are not blocked.
+    std::shared_ptr<const ClassWhitelist> class_names = Load(expanded_file_path);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[expanded_file_path] = { mod_time, class_names };
+    return class_names;
+}
+
+
+void ClassWhitelistCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+
+std::shared_ptr<const ClassWhitelist> ClassWhitelistCache::Load(const std::string &expanded_file_path) {
+    std::ifstream whitelist_file(expanded_file_path);
+    if (!whitelist_file.good()) {
+        throw MPFDetectionException(
+                MPF_COULD_NOT_OPEN_DATAFILE,
+                "Failed to load class whitelist that was supposed to be located at \""
+                + expanded_file_path + "\".");
+    }
+
+    auto class_names = std::make_shared<ClassWhitelist>();
+    std::string line;
+    while (std::getline(whitelist_file, line)) {
+        Utils::trim(line);
+        if (!line.empty()) {
+            class_names->insert(line);
+        }
+    }
+
+    if (class_names->empty()) {
+        throw MPFDetectionException(
+                MPF_COULD_NOT_READ_DATAFILE,
+                "The class whitelist file located at \"" + expanded_file_path + "\" was empty.");
+    }
+    return class_names;
+}
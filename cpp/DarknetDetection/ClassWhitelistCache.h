@@ -0,0 +1,65 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+#ifndef OPENMPF_COMPONENTS_CLASSWHITELISTCACHE_H
+#define OPENMPF_COMPONENTS_CLASSWHITELISTCACHE_H
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <MPFDetectionComponent.h>
+
+#include "include/DarknetInterface.h"
+
+
+// Caches the contents of CLASS_WHITELIST_FILE so that each file is only parsed once, rather than once per job.
+// The Darknet wrapper library is loaded and unloaded for every job, so the cache is kept by the component and the
+// parsed whitelist is passed in to the wrapper. An entry is reloaded when the file's modification time changes.
+class ClassWhitelistCache {
+public:
+    // Returns null when the CLASS_WHITELIST_FILE property is not set.
+    std::shared_ptr<const ClassWhitelist> Get(const MPF::COMPONENT::Properties &job_properties);
+
+    void Clear();
+
+private:
+    struct Entry {
+        time_t mod_time;
+        std::shared_ptr<const ClassWhitelist> class_names;
+    };
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+
+    static std::shared_ptr<const ClassWhitelist> Load(const std::string &expanded_file_path);
+};
+
+
+#endif //OPENMPF_COMPONENTS_CLASSWHITELISTCACHE_H
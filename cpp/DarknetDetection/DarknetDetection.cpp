@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <exception>
+#include <memory>
 #include <unordered_map>
 #include <utility>
 
@@ -191,13 +192,15 @@ TDarknetDl DarknetDetection::GetDarknetImpl(const MPFJob &job,
                                             const std::string &creator, const std::string &deleter) {
 
     const ModelSettings model_settings = GetModelSettings(job.job_properties);
+    std::shared_ptr<const ClassWhitelist> class_whitelist = class_whitelist_cache_.Get(job.job_properties);
 
     int cuda_device_id = DetectionComponentUtils::GetProperty(job.job_properties, "CUDA_DEVICE_ID", -1);
     if (cuda_device_id >= 0) {
         try {
             LOG4CXX_DEBUG(logger_, "[" << job.job_name << "] Attempting to load the GPU version of Darknet...")
             auto darknetDl = TDarknetDl(gpu_darknet_lib_path_, creator, deleter,
-                                        &job.job_name, &job.job_properties, &model_settings, &logger_);
+                                        &job.job_name, &job.job_properties, &model_settings, class_whitelist.get(),
+                                        &logger_);
             LOG4CXX_DEBUG(logger_, "[" << job.job_name << "] Successfully loaded the GPU version of Darknet.")
             return darknetDl;
         }
@@ -214,7 +217,8 @@ TDarknetDl DarknetDetection::GetDarknetImpl(const MPFJob &job,
     }
     LOG4CXX_DEBUG(logger_, "[" << job.job_name << "] Attempting to load the CPU version of Darknet...")
     auto darknetDl = TDarknetDl(cpu_darknet_lib_path_, creator, deleter,
-                                &job.job_name, &job.job_properties, &model_settings, &logger_);
+                                &job.job_name, &job.job_properties, &model_settings, class_whitelist.get(),
+                                &logger_);
     LOG4CXX_DEBUG(logger_, "[" << job.job_name << "] Successfully loaded the CPU version of Darknet.")
     return darknetDl;
 }
@@ -268,6 +272,7 @@ std::string DarknetDetection::GetDetectionType() {
 
 
 bool DarknetDetection::Close() {
+    class_whitelist_cache_.Clear();
     return true;
 }
 
@@ -39,6 +39,7 @@
 #include <MPFDetectionObjects.h>
 
 #include "include/DarknetInterface.h"
+#include "ClassWhitelistCache.h"
 #include "Trackers.h"
 
 
@@ -71,6 +72,8 @@ private:
 
     MPF::COMPONENT::ModelsIniParser<ModelSettings> models_parser_;
 
+    ClassWhitelistCache class_whitelist_cache_;
+
 
     DarknetAsyncDl GetDarknetImpl(const MPF::COMPONENT::MPFVideoJob &job);
 
@@ -27,6 +27,7 @@
 #include "DarknetStreamingDetection.h"
 
 #include <exception>
+#include <memory>
 #include <sstream>
 #include <utility>
 
@@ -36,6 +37,7 @@
 #include <detectionComponentUtils.h>
 
 #include "include/DarknetInterface.h"
+#include "ClassWhitelistCache.h"
 #include "Trackers.h"
 
 
@@ -70,6 +72,8 @@ namespace {
         static const std::string deleter_fn_name = "darknet_impl_deleter";
 
         const ModelSettings model_settings = GetModelSettings(job);
+        // A streaming job only loads its detector once, so there is nothing to gain from keeping the cache.
+        std::shared_ptr<const ClassWhitelist> class_whitelist = ClassWhitelistCache().Get(job.job_properties);
 
         int cuda_device_id = DetectionComponentUtils::GetProperty(job.job_properties, "CUDA_DEVICE_ID", -1);
         if (cuda_device_id >= 0) {
@@ -77,7 +81,7 @@ namespace {
                 std::string gpu_darknet_lib_path
                         = job.run_directory + "/DarknetDetection/lib/libdarknet_wrapper_cuda.so";
                 return { gpu_darknet_lib_path, creator_fn_name, deleter_fn_name,
-                            &job.job_name, &job.job_properties, &model_settings, &logger };
+                            &job.job_name, &job.job_properties, &model_settings, class_whitelist.get(), &logger };
             }
             catch (const std::exception &ex) {
                 if (DetectionComponentUtils::GetProperty(job.job_properties, "FALLBACK_TO_CPU_WHEN_GPU_PROBLEM", false)) {
@@ -93,7 +97,7 @@ namespace {
         std::string cpu_darknet_lib_path
                 = job.run_directory + "/DarknetDetection/lib/libdarknet_wrapper.so";
         return { cpu_darknet_lib_path, creator_fn_name, deleter_fn_name,
-                    &job.job_name, &job.job_properties, &model_settings, &logger };
+                    &job.job_name, &job.job_properties, &model_settings, class_whitelist.get(), &logger };
     }
 
     std::function< std::vector<MPFVideoTrack> (std::vector<DarknetResult>&&) >
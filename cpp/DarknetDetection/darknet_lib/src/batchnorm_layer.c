@@ -135,7 +135,8 @@ void resize_batchnorm_layer(layer *layer, int w, int h)
 void forward_batchnorm_layer(layer l, network net)
 {
     if(l.type == BATCHNORM) copy_cpu(l.outputs*l.batch, net.input, 1, l.output, 1);
-    copy_cpu(l.outputs*l.batch, l.output, 1, l.x, 1);
+    // openmpf modification: l.x is only needed for training and is freed when a network is loaded for inference only.
+    if(l.x) copy_cpu(l.outputs*l.batch, l.output, 1, l.x, 1);
     if(net.train){
         mean_cpu(l.output, l.batch, l.out_c, l.out_h*l.out_w, l.mean);
         variance_cpu(l.output, l.mean, l.batch, l.out_c, l.out_h*l.out_w, l.variance);
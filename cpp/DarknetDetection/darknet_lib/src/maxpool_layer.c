@@ -106,7 +106,9 @@ void forward_maxpool_layer(const maxpool_layer l, network net)
                         }
                     }
                     l.output[out_index] = max;
-                    l.indexes[out_index] = max_i;
+                    // openmpf modification: l.indexes is only needed for training and is freed when a network is
+                    // loaded for inference only.
+                    if(l.indexes) l.indexes[out_index] = max_i;
                 }
             }
         }
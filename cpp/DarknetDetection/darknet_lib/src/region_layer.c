@@ -185,7 +185,9 @@ void forward_region_layer(const layer l, network net)
     }
 #endif
 
-    memset(l.delta, 0, l.outputs * l.batch * sizeof(float));
+    // openmpf modification: l.delta is only needed for training and is freed when a network is loaded for
+    // inference only.
+    if(l.delta) memset(l.delta, 0, l.outputs * l.batch * sizeof(float));
     if(!net.train) return;
     float avg_iou = 0;
     float recall = 0;
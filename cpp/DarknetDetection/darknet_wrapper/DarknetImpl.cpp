@@ -27,10 +27,14 @@
 
 #include "DarknetImpl.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <map>
+#include <new>
+#include <numeric>
 #include <sstream>
 #include <stdexcept>
 #include <unordered_set>
@@ -301,16 +305,185 @@ namespace {
 #endif
         FreeAndClear(net->cost);
 
+        // When a network is loaded in inference only mode, multiple layers share the same output buffer.
+        std::unordered_set<float*> freed_outputs;
         for (int i = 0; i < net->n; i++) {
-            DestroyLayer(net->layers[i]);
+            layer &layer = net->layers[i];
+            if (layer.output != nullptr && !freed_outputs.insert(layer.output).second) {
+                layer.output = nullptr;
+            }
+            DestroyLayer(layer);
         }
 
         free_network(net);
     }
 
 
-    DarknetHelpers::network_ptr_t LoadNetwork(const std::string &log_prefix, const ModelSettings &model_settings,
-                                              log4cxx::LoggerPtr &logger) {
+    // The layer types whose forward pass only reads the previous layer's output, or the outputs referenced by
+    // a route or shortcut layer, and that do not need the training buffers.
+    bool SupportsInferenceOnlyMode(const layer &layer) {
+        switch (layer.type) {
+            case CONVOLUTIONAL:
+            case CONNECTED:
+            case MAXPOOL:
+            case AVGPOOL:
+            case SOFTMAX:
+            case ROUTE:
+            case SHORTCUT:
+            case UPSAMPLE:
+            case REORG:
+            case REGION:
+            case YOLO:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+
+    void FreeTrainingBuffers(layer &layer) {
+        FreeAndClear(layer.delta);
+        FreeAndClear(layer.x);
+        FreeAndClear(layer.x_norm);
+        FreeAndClear(layer.indexes);
+        FreeAndClear(layer.weight_updates);
+        FreeAndClear(layer.bias_updates);
+        FreeAndClear(layer.scale_updates);
+        FreeAndClear(layer.mean_delta);
+        FreeAndClear(layer.variance_delta);
+        FreeAndClear(layer.m);
+        FreeAndClear(layer.v);
+        FreeAndClear(layer.bias_m);
+        FreeAndClear(layer.bias_v);
+        FreeAndClear(layer.scale_m);
+        FreeAndClear(layer.scale_v);
+    }
+
+
+    // Returns the index of the last layer that reads each layer's output. Every layer reads the output of the
+    // layer before it. Route and shortcut layers also read the outputs of earlier layers. The outputs of the
+    // YOLO and region layers, as well as the final layer, are read by get_network_boxes after the forward pass,
+    // so they must remain valid until the end.
+    std::vector<int> GetLastUses(const network &net) {
+        std::vector<int> last_uses(static_cast<size_t>(net.n), 0);
+        for (int i = 0; i < net.n; i++) {
+            const layer &layer = net.layers[i];
+            last_uses[i] = std::max(last_uses[i], i + 1);
+            if (layer.type == ROUTE) {
+                for (int j = 0; j < layer.n; j++) {
+                    int input_idx = layer.input_layers[j];
+                    last_uses[input_idx] = std::max(last_uses[input_idx], i);
+                }
+            }
+            else if (layer.type == SHORTCUT) {
+                last_uses[layer.index] = std::max(last_uses[layer.index], i);
+            }
+
+            if (layer.type == YOLO || layer.type == REGION || i == net.n - 1) {
+                last_uses[i] = net.n;
+            }
+        }
+        return last_uses;
+    }
+
+
+    // Replaces the per-layer output buffers with a smaller set of shared buffers. A buffer is only handed to
+    // another layer after the last layer that reads its current contents has run. Returns the number of floats
+    // allocated for the shared buffers.
+    size_t ShareOutputBuffers(network &net) {
+        std::vector<int> last_uses = GetLastUses(net);
+
+        std::vector<size_t> buffer_sizes;
+        std::vector<int> buffer_free_after;
+        std::vector<size_t> assignments(static_cast<size_t>(net.n));
+
+        for (int i = 0; i < net.n; i++) {
+            auto required_size = static_cast<size_t>(net.layers[i].outputs);
+
+            // Prefer the smallest available buffer that is already large enough. When none are large enough,
+            // grow the largest available buffer.
+            int best_fit = -1;
+            int largest = -1;
+            for (int buf_idx = 0; buf_idx < static_cast<int>(buffer_sizes.size()); buf_idx++) {
+                if (buffer_free_after[buf_idx] >= i) {
+                    continue;
+                }
+                size_t size = buffer_sizes[buf_idx];
+                if (size >= required_size && (best_fit < 0 || size < buffer_sizes[best_fit])) {
+                    best_fit = buf_idx;
+                }
+                if (largest < 0 || size > buffer_sizes[largest]) {
+                    largest = buf_idx;
+                }
+            }
+
+            int chosen = best_fit >= 0 ? best_fit : largest;
+            if (chosen < 0) {
+                chosen = static_cast<int>(buffer_sizes.size());
+                buffer_sizes.push_back(0);
+                buffer_free_after.push_back(0);
+            }
+            buffer_sizes[chosen] = std::max(buffer_sizes[chosen], required_size);
+            buffer_free_after[chosen] = last_uses[i];
+            assignments[i] = static_cast<size_t>(chosen);
+        }
+
+        std::vector<float*> buffers;
+        buffers.reserve(buffer_sizes.size());
+        for (size_t size : buffer_sizes) {
+            auto buffer = static_cast<float*>(calloc(size, sizeof(float)));
+            if (buffer == nullptr) {
+                for (float* allocated : buffers) {
+                    free(allocated);
+                }
+                throw std::bad_alloc();
+            }
+            buffers.push_back(buffer);
+        }
+
+        for (int i = 0; i < net.n; i++) {
+            FreeAndClear(net.layers[i].output);
+            net.layers[i].output = buffers[assignments[i]];
+        }
+        net.output = get_network_output_layer(&net).output;
+
+        return std::accumulate(buffer_sizes.begin(), buffer_sizes.end(), size_t(0));
+    }
+
+
+    // Darknet allocates everything needed to train a network, including a separate output buffer for every layer
+    // sized for the batch size in the network config file. DarknetImpl only runs inference on one frame at a time,
+    // so the training buffers are freed and the layers' outputs are packed into shared buffers.
+    void ConfigureForInferenceOnly(network &net, const std::string &log_prefix, log4cxx::LoggerPtr &logger) {
+#ifdef GPU
+        LOG4CXX_DEBUG(logger, log_prefix << "Inference only mode is not supported by the CUDA version of Darknet. "
+                                         << "The network will be loaded normally.");
+#else
+        for (int i = 0; i < net.n; i++) {
+            if (!SupportsInferenceOnlyMode(net.layers[i])) {
+                LOG4CXX_DEBUG(logger, log_prefix << "Inference only mode is not supported by layer " << i
+                                                 << " of the network. The network will be loaded normally.");
+                return;
+            }
+        }
+
+        size_t original_floats = 0;
+        for (int i = 0; i < net.n; i++) {
+            original_floats += static_cast<size_t>(net.layers[i].outputs) * net.layers[i].batch;
+            FreeTrainingBuffers(net.layers[i]);
+        }
+        set_batch_network(&net, 1);
+
+        size_t shared_floats = ShareOutputBuffers(net);
+        LOG4CXX_DEBUG(logger, log_prefix << "Reduced layer output memory from "
+                << original_floats * sizeof(float) / (1024 * 1024) << " MiB to "
+                << shared_floats * sizeof(float) / (1024 * 1024) << " MiB.");
+#endif
+    }
+
+
+    DarknetHelpers::network_ptr_t LoadNetwork(const std::string &log_prefix, const Properties &props,
+                                              const ModelSettings &model_settings, log4cxx::LoggerPtr &logger) {
         auto cfg_file = ToNonConstCStr(model_settings.network_config_file);
         auto weights_file = ToNonConstCStr(model_settings.weights_file);
 
@@ -320,6 +493,9 @@ namespace {
 
         DarknetHelpers::network_ptr_t network(load_network(cfg_file.get(), weights_file.get(), 0),
                                               DestroyNetwork);
+        if (DetectionComponentUtils::GetProperty(props, "INFERENCE_ONLY_MODE", true)) {
+            ConfigureForInferenceOnly(*network, log_prefix, logger);
+        }
         LOG4CXX_DEBUG(logger, log_prefix << "Successfully loaded network.")
         return network;
     }
@@ -375,15 +551,10 @@ namespace {
     }
 
 
-    bool HasWhitelist(const Properties &props) {
-        return !DetectionComponentUtils::GetProperty(props, "CLASS_WHITELIST_FILE", std::string())
-                    .empty();
-    }
-
-
     class NoOpFilter {
     public:
-        NoOpFilter(const std::map<std::string, std::string> &, const std::vector<std::string>&) { }
+        NoOpFilter(const std::map<std::string, std::string> &, const ClassWhitelist *,
+                   const std::vector<std::string>&) { }
 
         bool operator()(const std::string &) { return true; }
     };
@@ -392,41 +563,11 @@ namespace {
     class WhitelistFilter {
     public:
 
-        WhitelistFilter(const Properties& props, const std::vector<std::string>& names) {
-            const std::string &whitelist_path = props.at("CLASS_WHITELIST_FILE");
-            std::string expanded_file_path;
-            std::string error = Utils::expandFileName(whitelist_path, expanded_file_path);
-            if (!error.empty()) {
-                throw MPFInvalidPropertyException(
-                        "CLASS_WHITELIST_FILE",
-                        "The value, \"" + whitelist_path + "\", could not be expanded due to: " + error);
-            }
-
-            std::ifstream whitelist_file(expanded_file_path);
-            if (!whitelist_file.good()) {
-                throw MPFDetectionException(
-                        MPF_COULD_NOT_OPEN_DATAFILE,
-                        "Failed to load class whitelist that was supposed to be located at \""
-                        + expanded_file_path + "\".");
-            }
-
-            std::unordered_set<std::string> temp_whitelist;
-            std::string line;
-            while (std::getline(whitelist_file, line)) {
-                Utils::trim(line);
-                if (!line.empty()) {
-                    temp_whitelist.insert(line);
-                }
-            }
-
-            if (temp_whitelist.empty()) {
-                throw MPFDetectionException(
-                        MPF_COULD_NOT_READ_DATAFILE,
-                        "The class whitelist file located at \"" + expanded_file_path + "\" was empty.");
-            }
-
+        // The whitelist file is parsed, and cached across jobs, by the component that loads this library.
+        WhitelistFilter(const Properties& props, const ClassWhitelist *class_whitelist,
+                        const std::vector<std::string>& names) {
             for (const std::string &name : names) {
-                if (temp_whitelist.count(name) > 0) {
+                if (class_whitelist->count(name) > 0) {
                     whitelist_.insert(name);
                 }
             }
@@ -435,7 +576,7 @@ namespace {
                 throw MPFDetectionException(
                         MPF_COULD_NOT_READ_DATAFILE,
                         "None of the class names specified in the whitelist file located at \""
-                        + expanded_file_path + "\" were found in the names file.");
+                        + props.at("CLASS_WHITELIST_FILE") + "\" were found in the names file.");
             }
         }
 
@@ -452,15 +593,16 @@ namespace {
 
 template<typename ClassFilter>
 DarknetImpl<ClassFilter>::DarknetImpl(const std::string &job_name, const std::map<std::string, std::string> &props,
-                                      const ModelSettings &settings, log4cxx::LoggerPtr &logger)
+                                      const ModelSettings &settings, const ClassWhitelist *class_whitelist,
+                                      log4cxx::LoggerPtr &logger)
     : DarknetInterface(props, settings)
     , log_prefix_("[" + job_name + "] ")
     , logger_(logger)
-    , network_(LoadNetwork(log_prefix_, settings, logger_))
+    , network_(LoadNetwork(log_prefix_, props, settings, logger_))
     , output_layer_size_(GetOutputLayerSize(*network_))
     , num_classes_(GetNumClasses(*network_))
     , names_(LoadNames(settings, num_classes_))
-    , class_filter_(props, names_)
+    , class_filter_(props, class_whitelist, names_)
     // Darknet will output of a probability for every possible class regardless of the content of the image.
     // Most of these classes will have a probability of zero or a number very close to zero.
     // If the confidence threshold is zero or smaller it will report every possible classification.
@@ -519,17 +661,18 @@ cv::Size DarknetImpl<ClassFilter>::GetTargetFrameSize() {
 
 
 DarknetAsyncImpl::DarknetAsyncImpl(const std::string &job_name, const Properties &props,
-                                   const ModelSettings &settings, log4cxx::LoggerPtr &logger)
+                                   const ModelSettings &settings, const ClassWhitelist *class_whitelist,
+                                   log4cxx::LoggerPtr &logger)
     : DarknetAsyncInterface(props, settings)
     , log_prefix_("[" + job_name + "] ")
     , logger_(logger)
     , work_queue_(DetectionComponentUtils::GetProperty(props, "FRAME_QUEUE_CAPACITY", 4))
 {
-    if (HasWhitelist(props)) {
-        Init<WhitelistFilter>(job_name, props, settings);
+    if (class_whitelist != nullptr) {
+        Init<WhitelistFilter>(job_name, props, settings, class_whitelist);
     }
     else {
-        Init<NoOpFilter>(job_name, props, settings);
+        Init<NoOpFilter>(job_name, props, settings, class_whitelist);
     }
 }
 
@@ -543,8 +686,9 @@ DarknetAsyncImpl::~DarknetAsyncImpl() {
 
 
 template<typename ClassFilter>
-void DarknetAsyncImpl::Init(const std::string &job_name, const Properties &props, const ModelSettings &settings) {
-    DarknetImpl<ClassFilter> darknet_impl(job_name, props, settings, logger_);
+void DarknetAsyncImpl::Init(const std::string &job_name, const Properties &props, const ModelSettings &settings,
+                            const ClassWhitelist *class_whitelist) {
+    DarknetImpl<ClassFilter> darknet_impl(job_name, props, settings, class_whitelist, logger_);
     target_frame_size_ = darknet_impl.GetTargetFrameSize();
     work_done_future_ = std::async(std::launch::async,
                                    ProcessFrameQueue<ClassFilter>, std::move(darknet_impl), std::ref(work_queue_));
@@ -653,13 +797,14 @@ extern "C" {
     DarknetInterface* darknet_impl_creator(const std::string *job_name,
                                            const std::map<std::string, std::string> *props,
                                            const ModelSettings *settings,
+                                           const ClassWhitelist *class_whitelist,
                                            log4cxx::LoggerPtr *logger) {
         configure_cuda_device(*props);
-        if (HasWhitelist(*props)) {
-            return new DarknetImpl<WhitelistFilter>(*job_name, *props, *settings, *logger);
+        if (class_whitelist != nullptr) {
+            return new DarknetImpl<WhitelistFilter>(*job_name, *props, *settings, class_whitelist, *logger);
         }
         else {
-            return new DarknetImpl<NoOpFilter>(*job_name, *props, *settings, *logger);
+            return new DarknetImpl<NoOpFilter>(*job_name, *props, *settings, class_whitelist, *logger);
         }
     }
 
@@ -671,9 +816,10 @@ extern "C" {
     DarknetAsyncInterface* darknet_async_impl_creator(const std::string *job_name,
                                                       const std::map<std::string, std::string> *props,
                                                       const ModelSettings *settings,
+                                                      const ClassWhitelist *class_whitelist,
                                                       log4cxx::LoggerPtr *logger) {
         configure_cuda_device(*props);
-        return new DarknetAsyncImpl(*job_name, *props, *settings, *logger);
+        return new DarknetAsyncImpl(*job_name, *props, *settings, class_whitelist, *logger);
     }
 
     void darknet_async_impl_deleter(DarknetAsyncInterface *impl) {
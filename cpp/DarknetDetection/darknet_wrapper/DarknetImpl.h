@@ -58,7 +58,7 @@ class DarknetImpl : public DarknetInterface {
 
 public:
     DarknetImpl(const std::string &job_name, const MPF::COMPONENT::Properties &props,
-                const ModelSettings &settings, log4cxx::LoggerPtr &logger);
+                const ModelSettings &settings, const ClassWhitelist *class_whitelist, log4cxx::LoggerPtr &logger);
 
     std::vector<DarknetResult> Detect(int frame_number, const cv::Mat &cv_image) override;
 
@@ -84,7 +84,8 @@ private:
 class DarknetAsyncImpl : public DarknetAsyncInterface {
 public:
     DarknetAsyncImpl(const std::string &job_name, const MPF::COMPONENT::Properties &props,
-                     const ModelSettings &settings, log4cxx::LoggerPtr &logger);
+                     const ModelSettings &settings, const ClassWhitelist *class_whitelist,
+                     log4cxx::LoggerPtr &logger);
 
     ~DarknetAsyncImpl() override;
 
@@ -107,7 +108,8 @@ private:
     bool get_results_called_ = false;
 
     template<typename ClassFilter>
-    void Init(const std::string &job_name, const MPF::COMPONENT::Properties &props, const ModelSettings &settings);
+    void Init(const std::string &job_name, const MPF::COMPONENT::Properties &props, const ModelSettings &settings,
+              const ClassWhitelist *class_whitelist);
 
 
     // Runs on a thread spawned by the call to std::async in the Init method.
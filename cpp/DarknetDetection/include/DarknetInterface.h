@@ -30,6 +30,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -53,6 +54,9 @@ struct DarknetResult {
     }
 };
 
+// The class names listed in a CLASS_WHITELIST_FILE.
+using ClassWhitelist = std::unordered_set<std::string>;
+
 struct ModelSettings {
     std::string network_config_file;
     std::string names_file;
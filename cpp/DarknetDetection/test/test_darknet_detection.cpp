@@ -130,6 +130,45 @@ TEST(Darknet, VideoTest) {
 }
 
 
+TEST(Darknet, InferenceOnlyModeMatchesDefaultMode) {
+    int end_frame = 4;
+    DarknetDetection component = init_component();
+
+    Properties inference_only_props = get_yolo_tiny_config();
+    inference_only_props["INFERENCE_ONLY_MODE"] = "true";
+    MPFVideoJob inference_only_job("Test", "data/lp-ferrari-texas-shortened.mp4", 0, end_frame,
+                                   inference_only_props, {});
+    std::vector<MPFVideoTrack> inference_only_tracks = component.GetDetections(inference_only_job);
+
+    Properties default_props = get_yolo_tiny_config();
+    default_props["INFERENCE_ONLY_MODE"] = "false";
+    MPFVideoJob default_job("Test", "data/lp-ferrari-texas-shortened.mp4", 0, end_frame, default_props, {});
+    std::vector<MPFVideoTrack> default_tracks = component.GetDetections(default_job);
+
+    ASSERT_FALSE(default_tracks.empty());
+    ASSERT_EQ(default_tracks.size(), inference_only_tracks.size());
+    for (int i = 0; i < default_tracks.size(); i++) {
+        const MPFVideoTrack &expected = default_tracks.at(i);
+        const MPFVideoTrack &actual = inference_only_tracks.at(i);
+        ASSERT_EQ(expected.start_frame, actual.start_frame);
+        ASSERT_EQ(expected.stop_frame, actual.stop_frame);
+        ASSERT_EQ(expected.detection_properties.at("CLASSIFICATION"),
+                  actual.detection_properties.at("CLASSIFICATION"));
+        ASSERT_EQ(expected.frame_locations.size(), actual.frame_locations.size());
+
+        for (const auto &frame_location_pair : expected.frame_locations) {
+            const MPFImageLocation &expected_location = frame_location_pair.second;
+            const MPFImageLocation &actual_location = actual.frame_locations.at(frame_location_pair.first);
+            ASSERT_EQ(expected_location.x_left_upper, actual_location.x_left_upper);
+            ASSERT_EQ(expected_location.y_left_upper, actual_location.y_left_upper);
+            ASSERT_EQ(expected_location.width, actual_location.width);
+            ASSERT_EQ(expected_location.height, actual_location.height);
+            ASSERT_TRUE(almost_equal(expected_location.confidence, actual_location.confidence));
+        }
+    }
+}
+
+
 TEST(DarknetStreaming, VideoTest) {
     int end_frame = 4;
     MPFStreamingVideoJob job("Test", "../plugin/", get_yolo_tiny_config(), {});
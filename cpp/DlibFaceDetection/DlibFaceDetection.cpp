@@ -37,6 +37,7 @@
 #include <QFileInfo>
 
 
+#include <cmath>
 #include <cstdlib>
 #include <stdio.h>
 #include <algorithm>
@@ -62,8 +63,8 @@ using cv::imshow;
 using cv::namedWindow;
 using cv::destroyAllWindows;
 using cv::waitKey;
+using cv::resize;
 using cv::pyrUp;
-using cv::pyrDown;
 
 using dlib::correlation_tracker;
 using dlib::rectangle;
@@ -78,7 +79,8 @@ string DlibFaceDetection::GetDetectionType() {
 }
 
 void DlibFaceDetection::SetModes(bool display_window, bool print_debug_info) {
-    imshow_on = display_window;
+    //each job reads IMSHOW_ON from the config parameters
+    parameters["IMSHOW_ON"] = display_window ? "1" : "0";
 
     if (print_debug_info && logger_ != NULL) {
         logger_->setLevel(log4cxx::Level::getDebug());
@@ -109,10 +111,8 @@ bool DlibFaceDetection::Init() {
 
     dlib_face_detector = dlib::get_frontal_face_detector();
 
-    SetDefaultParameters();
-
-    //once this is done - parameters will be set and SetReadConfigParameters() can be called again to revert back
-    //to the params read at initialization
+    //the parameters read here are shared by all jobs - each job copies them into its own context with
+    //SetReadConfigParameters()
 
     string config_params_path = config_path + "/mpfDlibFaceDetection.ini";
     int rc = LoadConfig(config_params_path, parameters);
@@ -121,8 +121,6 @@ bool DlibFaceDetection::Init() {
         return (false);
     }
 
-    SetReadConfigParameters();
-
     return true;
 }
 
@@ -131,81 +129,107 @@ bool DlibFaceDetection::Close() {
 }
 
 /*
- * Called during Init
+ * Called at the beginning of each job
  */
-void DlibFaceDetection::SetDefaultParameters() {
+void DlibFaceDetection::SetDefaultParameters(DlibFaceJobContext &context) {
 
-    verbosity = 0;
-    imshow_on = false;
+    context.verbosity = 0;
+    context.imshow_on = false;
 
     //min dlib object detection confidence
     //needed to start a new track
-    min_detection_confidence = 0.1;
+    context.min_detection_confidence = 0.1;
 
     //the maximum allowable overlap
     //rate between a new detection rect and
     //any existing track rects
-    max_intersection_overlap_pct = 0.2f;
+    context.max_intersection_overlap_pct = 0.2f;
 
     //the amount of frame locations required
     //to save a track
-    min_track_length = 3;
+    context.min_track_length = 3;
 
     //the minimum amount of similary required
     //by a detection to be matched with an
     //existing track
-    min_track_object_similarity_value = 0.6f;
+    context.min_track_object_similarity_value = 0.6f;
 
     //the minimum amount of correlation
     //between frames needed to continue tracking
-    min_update_correlation = 6.5;
+    context.min_update_correlation = 6.5;
+
+    //the detector finds faces of about 80 x 80 pixels, so frames are upsampled 2x to find faces down to
+    //40 x 40 pixels
+    context.min_face_size = 40;
+    context.max_face_size = 0;
+    context.detection_scale = 2.0;
+
+    //detect on every frame
+    context.detection_frame_interval = 1;
+    context.redetection_update_correlation = 8.0;
 
     //NOT ADDED TO THE CONFIG
     //this is the bounding box grow rate
     // that is used to grow the detection
     // rect before using it as a guess
     // rect for the tracker
-    bb_grow_rate = 0.08f;
+    context.bb_grow_rate = 0.08f;
 }
 
 /*
- * Called during Init
+ * Called at the beginning of each job
  */
-void DlibFaceDetection::SetReadConfigParameters() {
+void DlibFaceDetection::SetReadConfigParameters(DlibFaceJobContext &context) {
     //make sure none of the parameters are missed in the config file - double check
 
     if(parameters.contains("VERBOSE")) {
         //right now only accepting a VERBOSITY of 1 and just checking for > 0, may need to adjust later
         //if VERBOSITY 1 set the log level to DEBUG
         //if VERBOSITY set to 2, think about using TRACE
-        verbosity = parameters["VERBOSE"].toInt();
-        if (verbosity > 0) {
+        context.verbosity = parameters.value("VERBOSE").toInt();
+        if (context.verbosity > 0) {
             logger_->setLevel(log4cxx::Level::getDebug());
         }
     }
 
     if(parameters.contains("IMSHOW_ON")) {
-        imshow_on = (parameters["IMSHOW_ON"].toInt() > 0);
+        context.imshow_on = (parameters.value("IMSHOW_ON").toInt() > 0);
     }
 
     if(parameters.contains("MIN_DETECTION_CONFIDENCE")) {
-        min_detection_confidence = parameters["MIN_DETECTION_CONFIDENCE"].toDouble();
+        context.min_detection_confidence = parameters.value("MIN_DETECTION_CONFIDENCE").toDouble();
     }
 
     if(parameters.contains("MAX_INTERSECTION_OVERLAP_AREA_PCT")) {
-        max_intersection_overlap_pct = parameters["MAX_INTERSECTION_OVERLAP_AREA_PCT"].toFloat();
+        context.max_intersection_overlap_pct = parameters.value("MAX_INTERSECTION_OVERLAP_AREA_PCT").toFloat();
     }
 
     if(parameters.contains("MIN_TRACK_LENGTH")) {
-        min_track_length = parameters["MIN_TRACK_LENGTH"].toInt();
+        context.min_track_length = parameters.value("MIN_TRACK_LENGTH").toInt();
     }
 
     if(parameters.contains("MIN_TRACK_OBJECT_SIMILARITY_VALUE")) {
-        min_track_object_similarity_value = parameters["MIN_TRACK_OBJECT_SIMILARITY_VALUE"].toFloat();
+        context.min_track_object_similarity_value = parameters.value("MIN_TRACK_OBJECT_SIMILARITY_VALUE").toFloat();
     }
 
     if(parameters.contains("MIN_UPDATE_CORRELATION")) {
-        min_update_correlation = parameters["MIN_UPDATE_CORRELATION"].toDouble();
+        context.min_update_correlation = parameters.value("MIN_UPDATE_CORRELATION").toDouble();
+    }
+
+    if(parameters.contains("MIN_FACE_SIZE")) {
+        context.min_face_size = parameters.value("MIN_FACE_SIZE").toInt();
+    }
+
+    if(parameters.contains("MAX_FACE_SIZE")) {
+        context.max_face_size = parameters.value("MAX_FACE_SIZE").toInt();
+    }
+
+    if(parameters.contains("DETECTION_FRAME_INTERVAL")) {
+        context.detection_frame_interval = std::max(1, parameters.value("DETECTION_FRAME_INTERVAL").toInt());
+    }
+
+    if(parameters.contains("REDETECTION_UPDATE_CORRELATION")) {
+        context.redetection_update_correlation = parameters.value("REDETECTION_UPDATE_CORRELATION").toDouble();
     }
 }
 
@@ -213,7 +237,8 @@ void DlibFaceDetection::SetReadConfigParameters() {
  * This function reads a property value map and adjusts the settings for this component
  * and is called at the beginning of detection
  */
-void DlibFaceDetection::GetPropertySettings(const map <string, string> &algorithm_properties) {
+void DlibFaceDetection::GetPropertySettings(const map <string, string> &algorithm_properties,
+                                            DlibFaceJobContext &context) {
     string property;
     string str_value;
     int ivalue;
@@ -225,24 +250,83 @@ void DlibFaceDetection::GetPropertySettings(const map <string, string> &algorith
 
         //TODO: could restrict some of the parameter ranges here and log like PP!
         if (property == "VERBOSE") { //INT
-            verbosity = atoi(str_value.c_str());
+            context.verbosity = atoi(str_value.c_str());
         }
         else if (property == "MIN_DETECTION_CONFIDENCE") { //DOUBLE
-            min_detection_confidence = static_cast<double>(atof(str_value.c_str()));
+            context.min_detection_confidence = static_cast<double>(atof(str_value.c_str()));
         }
         else if (property == "MAX_INTERSECTION_OVERLAP_AREA_PCT") { //FLOAT
-            max_intersection_overlap_pct = atof(str_value.c_str());
+            context.max_intersection_overlap_pct = atof(str_value.c_str());
         }
         else if (property == "MIN_TRACK_OBJECT_SIMILARITY_VALUE") { //FLOAT
-            min_track_object_similarity_value = atof(str_value.c_str());
+            context.min_track_object_similarity_value = atof(str_value.c_str());
         }
         else if (property == "MIN_UPDATE_CORRELATION") { //DOUBLE
-            min_update_correlation = static_cast<double>(atof(str_value.c_str()));
+            context.min_update_correlation = static_cast<double>(atof(str_value.c_str()));
+        }
+        else if (property == "MIN_FACE_SIZE") { //INT
+            context.min_face_size = atoi(str_value.c_str());
+        }
+        else if (property == "MAX_FACE_SIZE") { //INT
+            context.max_face_size = atoi(str_value.c_str());
+        }
+        else if (property == "DETECTION_FRAME_INTERVAL") { //INT
+            context.detection_frame_interval = std::max(1, atoi(str_value.c_str()));
+        }
+        else if (property == "REDETECTION_UPDATE_CORRELATION") { //DOUBLE
+            context.redetection_update_correlation = static_cast<double>(atof(str_value.c_str()));
         }
     }
     return;
 }
 
+/*
+ * Called at the beginning of each job, after the job properties are read
+ * The detector finds faces of about 80 x 80 pixels and larger, so frames are scaled by 80 / MIN_FACE_SIZE - they
+ * are only upsampled when faces smaller than that need to be found, and are downsampled when only larger faces are
+ * wanted. Frames are upsampled at most 4x, so faces smaller than 20 x 20 pixels are not found - a smaller
+ * MIN_FACE_SIZE would make the upsampled frames too large to scan. The scanner's image pyramid is cut off at the
+ * level where the detector window is larger than MAX_FACE_SIZE, so larger faces are never scanned for.
+ */
+void DlibFaceDetection::ConfigureFaceDetector(DlibFaceJobContext &context) {
+    const double detector_window_size = 80.0;
+    const double max_detection_scale = 4.0;
+    context.detection_scale = detector_window_size / std::max(1, context.min_face_size);
+    if (context.detection_scale > max_detection_scale) {
+        LOG4CXX_WARN(logger_, "MIN_FACE_SIZE of " << context.min_face_size << " is below the smallest supported "
+                              << "size of " << detector_window_size / max_detection_scale << ". Frames will only be "
+                              << "upsampled " << max_detection_scale << "x, so smaller faces will not be found.");
+        context.detection_scale = max_detection_scale;
+    }
+
+    if (context.max_face_size <= 0) {
+        return;
+    }
+
+    //each pyramid level is 5/6 the size of the previous one, so the detector window covers 6/5 as many pixels of
+    //the frame at each level
+    double max_window_growth = (context.max_face_size * context.detection_scale) / detector_window_size;
+    unsigned long max_pyramid_levels = 1;
+    if (max_window_growth > 1.0) {
+        max_pyramid_levels += static_cast<unsigned long>(floor(log(max_window_growth) / log(6.0 / 5.0)));
+    }
+
+    //the scanner of a loaded detector can't be changed, so the detector is rebuilt with the same weights
+    dlib::frontal_face_detector::image_scanner_type scanner(context.face_detector.get_scanner());
+    if (max_pyramid_levels >= scanner.get_max_pyramid_levels()) {
+        return;
+    }
+    scanner.set_max_pyramid_levels(max_pyramid_levels);
+
+    vector<dlib::frontal_face_detector::feature_vector_type> weights;
+    for (unsigned long i = 0; i < context.face_detector.num_detectors(); i++) {
+        weights.push_back(context.face_detector.get_w(i));
+    }
+    context.face_detector = dlib::frontal_face_detector(scanner, context.face_detector.get_overlap_tester(), weights);
+
+    LOG4CXX_DEBUG(logger_, "Face detector pyramid limited to " << max_pyramid_levels << " levels");
+}
+
 /*
  * Determine how similar the current_track rectangle (last position) is to the new_rect
  */
@@ -262,9 +346,10 @@ float DlibFaceDetection::GetTrackObjectSimilarity(const DlibTrack &current_track
 /*
  * This will determine if the last position in the track (current_track) is similar to the rectangle (new_rect)
  */
-bool DlibFaceDetection::IsObjectSimilar(const DlibTrack &current_track, const rectangle &new_rect) {
+bool DlibFaceDetection::IsObjectSimilar(const DlibFaceJobContext &context, const DlibTrack &current_track,
+                                        const rectangle &new_rect) {
     float similarity = GetTrackObjectSimilarity(current_track, new_rect);
-    if(similarity >= min_track_object_similarity_value) {
+    if(similarity >= context.min_track_object_similarity_value) {
         return true;
     }
     return false;
@@ -276,15 +361,21 @@ bool DlibFaceDetection::IsObjectSimilar(const DlibTrack &current_track, const re
  * Returns the index of the most similar overlapping object in next_detected_objects
  * Return -1 if nothing found
  */
-int DlibFaceDetection::GetMostSimilarOverlappingObject(const DlibTrack &current_track,
-                                                       const vector<rect_detection> &next_detected_objects) {
+int DlibFaceDetection::GetMostSimilarOverlappingObject(const DlibFaceJobContext &context,
+                                                       const DlibTrack &current_track,
+                                                       const vector<rect_detection> &next_detected_objects,
+                                                       const vector<bool> &object_used) {
 
     int most_similar_index = -1;
     float best_similarity_value = 0.0f;
     for (size_t i = 0; i != next_detected_objects.size(); ++i) {
+        //objects already used by another track are skipped
+        if (object_used[i]) {
+            continue;
+        }
         //similarity will be 0 if not overlapping
         float track_object_similarity = GetTrackObjectSimilarity(current_track, next_detected_objects[i].rect);
-        if(track_object_similarity >= min_track_object_similarity_value &&
+        if(track_object_similarity >= context.min_track_object_similarity_value &&
            track_object_similarity > best_similarity_value) {
             best_similarity_value = track_object_similarity;
             //set index - will not overflow in this case
@@ -314,15 +405,15 @@ bool DlibFaceDetection::IsValidNewObject(const DlibTrack &current_track, const r
     return true;
 }
 
-void DlibFaceDetection::CloseAnyOpenTracks() {
-    if (!current_tracks.empty()) {
+void DlibFaceDetection::CloseAnyOpenTracks(DlibFaceJobContext &context) {
+    if (!context.current_tracks.empty()) {
         //need to stop all current tracks!
-        for(auto &current_track : current_tracks) {
+        for(auto &current_track : context.current_tracks) {
 
             //should never happen - but ignoring the track if stop frame already modified or
             //there are less than MIN_TRACK_LENGTH frame locations
             if (current_track.mpf_video_track.stop_frame != -1
-                || current_track.mpf_video_track.frame_locations.size() < min_track_length) {
+                || current_track.mpf_video_track.frame_locations.size() < context.min_track_length) {
                 continue;
             }
 
@@ -333,15 +424,15 @@ void DlibFaceDetection::CloseAnyOpenTracks() {
             current_track.mpf_video_track.stop_frame = last_used_frame_location_index;
 
             //now the track can be saved
-            saved_tracks.push_back(current_track);
+            context.saved_tracks.push_back(current_track);
         }
     }
 }
 
-void DlibFaceDetection::GrowRect(rectangle &rect) {
+void DlibFaceDetection::GrowRect(const DlibFaceJobContext &context, rectangle &rect) {
 
-    int width_adjust = floor( (rect.width() * bb_grow_rate) / 2.0f);
-    int height_adjust = floor( (rect.height() * bb_grow_rate) / 2.0f);
+    int width_adjust = floor( (rect.width() * context.bb_grow_rate) / 2.0f);
+    int height_adjust = floor( (rect.height() * context.bb_grow_rate) / 2.0f);
 
     rect.set_left((rect.left() - width_adjust));
     rect.set_top((rect.top() - height_adjust));
@@ -394,87 +485,113 @@ void DlibFaceDetection::DlibRectToMPFImageLocation(const rectangle &object_rect,
                                             object_rect.width(), object_rect.height(), object_detection_confidence);
 }
 
-void DlibFaceDetection::UpdateTracks(const dlib::cv_image<dlib::uint8> &next_frame_gray, const Mat &next_frame_gray_mat,
-                                     vector<rect_detection> &next_detected_objects, int frame_index) {
+bool DlibFaceDetection::UpdateTracks(DlibFaceJobContext &context,
+                                     const dlib::cv_image<dlib::uint8> &next_frame_gray, const Mat &next_frame_gray_mat,
+                                     const vector<rect_detection> &next_detected_objects, int frame_index) {
 
-    //loop through existing tracks locating the most similar newly detected object (from next_detected_objects)
-    //remove any newly detected objects that are used
-    auto current_track = begin(current_tracks);
-    while (current_track != end(current_tracks)) {
-
-        //remember that "current_track->updated" is not the same as the correlation_tracker update - that happens each time
-        //UpdateTracks is called. If updated is true then the track location will have an updated confidence value and if false
-        //the value will be 0.0f
-        //back to false before seeing if there is a new rect that can be used for updating
-        current_track->updated = false;
+    //set when a tracker loses or is about to lose its face, so faces should be detected on the next frame
+    bool redetect = false;
 
+    //loop through existing tracks locating the most similar newly detected object (from next_detected_objects)
+    //the objects are assigned before any tracker is updated, using the track positions from the previous frame, so
+    //the assignment is the same as when each track was updated right after being assigned its object
+    //an object that is used by a track can't be used by any later track or to start a new track
+    vector<bool> object_used(next_detected_objects.size(), false);
+    vector<int> most_similar_indexes(context.current_tracks.size(), -1);
+    for (size_t i = 0; i != context.current_tracks.size(); ++i) {
         //GetMostSimilarOverlappingObject can be used without checking all tracks to see if a track might share more similary to one of the objects
         // because the detections should not overlap and will require a high percentage of overlap to even be considered similar
-        int most_similar_index = GetMostSimilarOverlappingObject(*current_track, next_detected_objects);
-
-        //tracker update confidence
-        double update_conf = -1.0f;
-        //object detection confidence
-        double object_location_conf = 0.0f;
-
-        //GetMostSimilarOverlappingObject returns -1 if it cannot find a rect to use
+        int most_similar_index = GetMostSimilarOverlappingObject(context, context.current_tracks[i],
+                                                                 next_detected_objects, object_used);
         if(most_similar_index != -1) {
-            rect_detection valid_most_similar_object = next_detected_objects.at(most_similar_index);
-            rectangle valid_most_similar_object_rect = valid_most_similar_object.rect;
-
-            //duplicate the rect to modify
-            rectangle rect_to_grow(valid_most_similar_object_rect.tl_corner(), valid_most_similar_object_rect.br_corner());
+            object_used[most_similar_index] = true;
+            most_similar_indexes[i] = most_similar_index;
+        }
+    }
 
-            //grow the rect for help in guessing
-            // the new track position
-            GrowRect(rect_to_grow);
-            //adjust to image bounds
-            AdjustRectToEdgesDlib(rect_to_grow, next_frame_gray_mat);
+    //each correlation tracker only uses its own state and the frame, so the trackers are updated in parallel
+    //tracker update confidence
+    vector<double> update_confs(context.current_tracks.size(), -1.0);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(context.current_tracks.size())), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; ++i) {
+            DlibTrack &current_track = context.current_tracks[i];
+
+            //remember that "current_track.updated" is not the same as the correlation_tracker update - that happens each time
+            //UpdateTracks is called. If updated is true then the track location will have an updated confidence value and if false
+            //the value will be 0.0f
+            //back to false before seeing if there is a new rect that can be used for updating
+            current_track.updated = false;
+
+            //GetMostSimilarOverlappingObject returns -1 if it cannot find a rect to use
+            if(most_similar_indexes[i] != -1) {
+                const rectangle &valid_most_similar_object_rect = next_detected_objects[most_similar_indexes[i]].rect;
+
+                //duplicate the rect to modify
+                rectangle rect_to_grow(valid_most_similar_object_rect.tl_corner(), valid_most_similar_object_rect.br_corner());
+
+                //grow the rect for help in guessing
+                // the new track position
+                GrowRect(context, rect_to_grow);
+                //adjust to image bounds
+                AdjustRectToEdgesDlib(rect_to_grow, next_frame_gray_mat);
+
+                //now try to update with grown rect
+                update_confs[i] = current_track.correlation_tracker.update(next_frame_gray, rect_to_grow);
+                current_track.updated = true;
+                current_track.frames_since_last_detection = 0;
+            } else {
+                //update without a guess
+                update_confs[i] = current_track.correlation_tracker.update(next_frame_gray);
+            }
+        }
+    });
 
-            //now try to update with grown rect
-            update_conf = current_track->correlation_tracker.update(next_frame_gray, rect_to_grow);
-            current_track->updated = true;
-            current_track->frames_since_last_detection = 0;
+    //the tracks are kept or stopped in order, so the saved tracks are in the same order as when updating serially
+    vector<DlibTrack> tracks_to_keep;
+    for (size_t i = 0; i != context.current_tracks.size(); ++i) {
+        DlibTrack &current_track = context.current_tracks[i];
 
-            object_location_conf = valid_most_similar_object.detection_confidence;
+        //object detection confidence
+        double object_location_conf = 0.0f;
+        if(most_similar_indexes[i] != -1) {
+            object_location_conf = next_detected_objects[most_similar_indexes[i]].detection_confidence;
+        }
 
-            //with the valid_most_similar_object_rect from next_detected_objects being used, erase it to reduce looping later
-            next_detected_objects.erase(next_detected_objects.begin() + most_similar_index);
-        } else {
-            //update without a guess
-            update_conf = current_track->correlation_tracker.update(next_frame_gray);
+        if (update_confs[i] < context.redetection_update_correlation) {
+            redetect = true;
         }
 
-        if (update_conf >= min_update_correlation) {
+        if (update_confs[i] >= context.min_update_correlation) {
             MPFImageLocation mpf_object_detection;
-            DlibRectToMPFImageLocation(current_track->correlation_tracker.get_position(), object_location_conf, mpf_object_detection);
-            current_track->mpf_video_track.frame_locations.insert(pair<int, MPFImageLocation>(frame_index, mpf_object_detection));
-            current_track->mpf_video_track.confidence = std::max(current_track->mpf_video_track.confidence,
-                                                                 mpf_object_detection.confidence);
-            //next track
-            ++current_track;
+            DlibRectToMPFImageLocation(current_track.correlation_tracker.get_position(), object_location_conf, mpf_object_detection);
+            current_track.mpf_video_track.frame_locations.insert(pair<int, MPFImageLocation>(frame_index, mpf_object_detection));
+            current_track.mpf_video_track.confidence = std::max(current_track.mpf_video_track.confidence,
+                                                                mpf_object_detection.confidence);
+            tracks_to_keep.push_back(std::move(current_track));
         } else {
-            //stop the track, save if meets requirements, and delete from current tracks
+            //stop the track and save if meets requirements
 
-            if(current_track->mpf_video_track.frame_locations.size() > min_track_length) {
+            if(current_track.mpf_video_track.frame_locations.size() > context.min_track_length) {
                 //since the frame interval can be adjusted it makes sense to grab the index from the last frame location
-                current_track->mpf_video_track.stop_frame = current_track->mpf_video_track.frame_locations.rbegin()->first;
-                saved_tracks.push_back(*current_track);
+                current_track.mpf_video_track.stop_frame = current_track.mpf_video_track.frame_locations.rbegin()->first;
+                context.saved_tracks.push_back(std::move(current_track));
             }
-
-            current_track = current_tracks.erase(current_track);
         }
     }
+    context.current_tracks = std::move(tracks_to_keep);
 
-    auto detected_object = begin(next_detected_objects);
-    while (detected_object != end(next_detected_objects)) {
+    for (size_t i = 0; i != next_detected_objects.size(); ++i) {
+        if (object_used[i]) {
+            continue;
+        }
 
-        rectangle detected_object_rect = detected_object->rect;
+        const rect_detection &detected_object = next_detected_objects[i];
+        const rectangle &detected_object_rect = detected_object.rect;
 
         //need to iterate if not used
         bool use_detected_object = true;
 
-        for (const auto &existing_track : current_tracks) {
+        for (const auto &existing_track : context.current_tracks) {
             if(!IsValidNewObject(existing_track, detected_object_rect)) {
                 use_detected_object = false;
                 break;
@@ -488,23 +605,20 @@ void DlibFaceDetection::UpdateTracks(const dlib::cv_image<dlib::uint8> &next_fra
             new_dlib_track.correlation_tracker.start_track(next_frame_gray, detected_object_rect);
 
             MPFImageLocation first_mpf_object_detection;
-            DlibRectToMPFImageLocation(detected_object_rect, detected_object->detection_confidence, first_mpf_object_detection);
+            DlibRectToMPFImageLocation(detected_object_rect, detected_object.detection_confidence, first_mpf_object_detection);
             new_dlib_track.mpf_video_track.frame_locations.insert(pair<int, MPFImageLocation>(frame_index, first_mpf_object_detection));
             new_dlib_track.mpf_video_track.confidence = std::max(new_dlib_track.mpf_video_track.confidence,
                                                                  first_mpf_object_detection.confidence);
 
-            current_tracks.push_back(new_dlib_track);
-
-            //delete this new detect object
-            detected_object = next_detected_objects.erase(detected_object);
-        } else {
-            ++detected_object;
+            context.current_tracks.push_back(std::move(new_dlib_track));
         }
     }
+
+    return redetect;
 }
 
 vector<MPFVideoTrack> DlibFaceDetection::GetDetectionsFromVideoCapture(
-        const MPFVideoJob &job, MPFVideoCapture &video_capture) {
+        DlibFaceJobContext &context, const MPFVideoJob &job, MPFVideoCapture &video_capture) {
 
     int total_frames = video_capture.GetFrameCount();
     LOG4CXX_INFO(logger_, "[" << job.job_name << "] Total video frames: " << total_frames);
@@ -513,10 +627,15 @@ vector<MPFVideoTrack> DlibFaceDetection::GetDetectionsFromVideoCapture(
 
     Mat frame, gray;
 
-    if(imshow_on) {
+    if(context.imshow_on) {
         namedWindow("Tracker Window", cv::WINDOW_AUTOSIZE );
     }
 
+    //faces are detected on the first frame and then every detection_frame_interval frames - the correlation trackers
+    //carry the faces in between, and detection is forced on the frame after a tracker loses or nearly loses its face
+    int frames_until_detection = 0;
+    bool redetect = false;
+
     while (video_capture.Read(frame)) {
 
 
@@ -524,15 +643,20 @@ vector<MPFVideoTrack> DlibFaceDetection::GetDetectionsFromVideoCapture(
         gray = Utils::ConvertToGray(frame);
 
         //look for new objects
-        vector<rect_detection> objects_detected = DetectFacesDlib(gray);
+        vector<rect_detection> objects_detected;
+        if (frames_until_detection <= 0 || redetect) {
+            objects_detected = DetectFacesDlib(context, gray);
+            frames_until_detection = context.detection_frame_interval;
+        }
+        --frames_until_detection;
 
         dlib::cv_image<dlib::uint8> dlib_img(gray);
-        UpdateTracks(dlib_img, gray, objects_detected, frame_index);
+        redetect = UpdateTracks(context, dlib_img, gray, objects_detected, frame_index);
 
-        if(imshow_on) {
+        if(context.imshow_on) {
             //can draw on frame because the detection step is complete
 
-            for(auto &current_track : current_tracks) {
+            for(auto &current_track : context.current_tracks) {
                 //get last object location
                 MPFImageLocation last_mpf_object_location = current_track.mpf_video_track.frame_locations.rbegin()->second;
 
@@ -552,24 +676,24 @@ vector<MPFVideoTrack> DlibFaceDetection::GetDetectionsFromVideoCapture(
 
         ++frame_index;
     }
-    CloseAnyOpenTracks();
+    CloseAnyOpenTracks(context);
 
     vector<MPFVideoTrack> tracks;
     //set tracks reference!
-    for (unsigned int i = 0; i < saved_tracks.size(); i++) {
-        tracks.push_back(saved_tracks[i].mpf_video_track);
+    for (unsigned int i = 0; i < context.saved_tracks.size(); i++) {
+        tracks.push_back(context.saved_tracks[i].mpf_video_track);
     }
 
     //clear any internal structures that could carry over before the destructor is called
     //these can be cleared - the data has been moved to tracks
-    current_tracks.clear();
-    saved_tracks.clear();
+    context.current_tracks.clear();
+    context.saved_tracks.clear();
 
     LOG4CXX_INFO(logger_, "[" << job.job_name << "] Processing complete. Found "
                               << static_cast<int>(tracks.size()) << " tracks.");
-    CloseWindows();
+    CloseWindows(context);
 
-    if (verbosity > 0) {
+    if (context.verbosity > 0) {
         //now print tracks if available
         if(!tracks.empty())
         {
@@ -600,17 +724,19 @@ vector<MPFVideoTrack> DlibFaceDetection::GetDetectionsFromVideoCapture(
 vector<MPFVideoTrack> DlibFaceDetection::GetDetections(const MPFVideoJob &job) {
     try {
         //set params to default and what was originally loaded in the .ini
-        SetDefaultParameters();
-        SetReadConfigParameters();
+        DlibFaceJobContext context(dlib_face_detector);
+        SetDefaultParameters(context);
+        SetReadConfigParameters(context);
 
         //configure params
         //algorithm_properties
         /* Use the algorithm properties map to adjust the settings, if not empty */
-        GetPropertySettings(job.job_properties);
+        GetPropertySettings(job.job_properties, context);
+        ConfigureFaceDetector(context);
 
         MPFVideoCapture video_capture(job, true, true);
 
-        vector<MPFVideoTrack> tracks = GetDetectionsFromVideoCapture(job, video_capture);
+        vector<MPFVideoTrack> tracks = GetDetectionsFromVideoCapture(context, job, video_capture);
         for (auto &track : tracks) {
             video_capture.ReverseTransform(track);
         }
@@ -624,7 +750,8 @@ vector<MPFVideoTrack> DlibFaceDetection::GetDetections(const MPFVideoJob &job) {
 
 
 // private - IMAGE
-vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(const MPFImageJob &job, Mat &image) {
+vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(DlibFaceJobContext &context,
+                                                                       const MPFImageJob &job, Mat &image) {
 
     /**************************/
     /* Read and Submit Image */
@@ -640,7 +767,7 @@ vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(const MPF
     LOG4CXX_DEBUG(logger_, "[" << job.job_name << "] Frame_width = " << frame_width);
     LOG4CXX_DEBUG(logger_, "[" << job.job_name << "] Frame_height = " << frame_height);
 
-    vector<rect_detection> object_detections = DetectFacesDlib(image_gray);
+    vector<rect_detection> object_detections = DetectFacesDlib(context, image_gray);
 
     LOG4CXX_DEBUG(logger_, "[" << job.job_name << "] Number of faces detected = " << object_detections.size());
 
@@ -656,7 +783,7 @@ vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(const MPF
         locations.push_back(mpf_object_detection);
     }
 
-    if (verbosity > 0) {
+    if (context.verbosity > 0) {
         // log the detections
         for (unsigned int i = 0; i < locations.size(); i++) {
             LOG4CXX_DEBUG(logger_, "[" << job.job_name << "] Detection # " << i);
@@ -664,9 +791,9 @@ vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(const MPF
         }
     }
 
-    if (verbosity > 0) {
+    if (context.verbosity > 0) {
         //    Draw a rectangle onto the input image for each detection
-        if (imshow_on) {
+        if (context.imshow_on) {
             namedWindow("original image", CV_WINDOW_AUTOSIZE);
             imshow("original image", image);
             waitKey(5);
@@ -678,7 +805,7 @@ vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(const MPF
                         locations[i].height);
             cv::rectangle(image, object, CV_RGB(0, 0, 0), 2);
         }
-        if (imshow_on) {
+        if (context.imshow_on) {
             namedWindow("new image", CV_WINDOW_AUTOSIZE);
             imshow("new image", image);
             //0 waits indefinitely for input, which could cause problems when run as a component
@@ -694,7 +821,7 @@ vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(const MPF
         }
         catch (runtime_error &ex) {
             LOG4CXX_ERROR(logger_, "[" << job.job_name << "] Exception writing image output file: " << ex.what());
-            CloseWindows();
+            CloseWindows(context);
             throw MPFDetectionException(MPF_OTHER_DETECTION_ERROR_TYPE,
                     std::string("Exception writing image output file: ") + ex.what());
         }
@@ -703,7 +830,7 @@ vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(const MPF
     LOG4CXX_INFO(logger_, "[" << job.job_name << "] Processing complete. Found "
                               << static_cast<int>(locations.size()) << " detections.");
 
-    CloseWindows();
+    CloseWindows(context);
     return locations;
 }
 
@@ -711,18 +838,20 @@ vector<MPFImageLocation> DlibFaceDetection::GetDetectionsFromImageData(const MPF
 vector<MPFImageLocation> DlibFaceDetection::GetDetections(const MPFImageJob &job) {
     try {
         //set params to default and what was originally loaded in the .ini
-        SetDefaultParameters();
-        SetReadConfigParameters();
+        DlibFaceJobContext context(dlib_face_detector);
+        SetDefaultParameters(context);
+        SetReadConfigParameters(context);
 
         //configure params
         //algorithm_properties
         /* Use the algorithm properties map to adjust the settings, if not empty */
-        GetPropertySettings(job.job_properties);
+        GetPropertySettings(job.job_properties, context);
+        ConfigureFaceDetector(context);
 
         MPFImageReader image_reader(job);
         cv::Mat image = image_reader.GetImage();
 
-        vector<MPFImageLocation> locations = GetDetectionsFromImageData(job, image);
+        vector<MPFImageLocation> locations = GetDetectionsFromImageData(context, job, image);
         for (auto &location : locations) {
             image_reader.ReverseTransform(location);
         }
@@ -737,83 +866,96 @@ vector<MPFImageLocation> DlibFaceDetection::GetDetections(const MPFImageJob &job
 
 
 
-vector<rect_detection> DlibFaceDetection::DetectFacesDlib(const Mat &frame_gray) {
+vector<rect_detection> DlibFaceDetection::DetectFacesDlib(DlibFaceJobContext &context, const Mat &frame_gray) {
 
-    //clone for pyramid up
-    Mat frame_gray_clone = frame_gray.clone();
-    equalizeHist( frame_gray_clone, frame_gray_clone);
+    Mat frame_gray_scaled;
+    equalizeHist(frame_gray, frame_gray_scaled);
 
-    //the beginning of this is from a dlib detection example
-    // "Make the image bigger by a factor of two.  This is useful since
-    // the face detector looks for faces that are about 80 by 80 pixels
-    // or larger.  Therefore, if you want to find faces that are smaller
-    // than that then you need to upsample the image as we do here by
-    // calling pyramid_up().  So this will allow it to detect faces that
-    // are at least 40 by 40 pixels in size.  We could call pyramid_up()
-    // again to find even smaller faces, but note that every time we
-    // upsample the image we make the detector run slower since it must
-    // process a larger image."
-    //will have to pyrdown the detection values
-    //From OpenCV documentation - By default, size of the output image is computed as Size(src.cols*2, (src.rows*2), but in any case, the following conditions should be satisfied:
-    //Note that this also blurs the image as well
-    pyrUp(frame_gray_clone, frame_gray_clone);
+    //the frame is only made bigger when faces smaller than the detector window are wanted - every upsample makes the
+    //detector slower since it must process a larger image
+    //the detection values are scaled back to the original frame afterwards
+    //pyrUp is kept for the default 2x scale, so the default detections are the same as before frames were scaled by
+    //the min face size
+    if (context.detection_scale == 2.0) {
+        pyrUp(frame_gray_scaled, frame_gray_scaled);
+    }
+    else if (context.detection_scale > 1.0) {
+        resize(frame_gray_scaled, frame_gray_scaled, cv::Size(), context.detection_scale, context.detection_scale,
+               cv::INTER_LINEAR);
+    }
+    else if (context.detection_scale < 1.0) {
+        resize(frame_gray_scaled, frame_gray_scaled, cv::Size(), context.detection_scale, context.detection_scale,
+               cv::INTER_AREA);
+    }
 
-    dlib::cv_image<dlib::uint8> cimg(frame_gray_clone);
+    dlib::cv_image<dlib::uint8> cimg(frame_gray_scaled);
 
     vector<rect_detection> object_detections;
-    dlib_face_detector(cimg, object_detections, min_detection_confidence);
+    context.face_detector(cimg, object_detections, context.min_detection_confidence);
 
     Mat frame_gray_clone_down;
-    string window_name_up = "Detected dlib Faces pyrUp";
-    string window_name_down = "Detected dlib Faces pyrDown";
-    if(imshow_on) {
+    string window_name_up = "Detected dlib Faces scaled";
+    string window_name_down = "Detected dlib Faces";
+    if(context.imshow_on) {
         frame_gray_clone_down = frame_gray.clone();
         namedWindow(window_name_up, cv::WINDOW_AUTOSIZE);
         namedWindow(window_name_down, cv::WINDOW_AUTOSIZE);
     }
 
-    //need to pyramid down the object_detections rectangles
+    //need to scale the object_detections rectangles back to the original frame
+    vector<rect_detection> scaled_object_detections;
     for(auto &object_detection : object_detections) {
 
-        if(imshow_on) {
+        if(context.imshow_on) {
             cv::Rect rect(object_detection.rect.tl_corner().x(), object_detection.rect.tl_corner().y(),
                           object_detection.rect.width(), object_detection.rect.height());
-            cv::rectangle(frame_gray_clone, rect, cv::Scalar(255,0,0));
+            cv::rectangle(frame_gray_scaled, rect, cv::Scalar(255,0,0));
         }
 
         //dlib uses long, yes long, for its rectangle x, y, h, w
-        //divide everything by 2 after the pyrUp
         //floor bottom left x and top right y and ceil of bottom left y and top right x (round up the rectangle)
         //cv mat reads from the top left (0,0)
-        int left = floor(((float) object_detection.rect.tl_corner().x()) / 2.0f);
-        int top = floor(((float) object_detection.rect.tl_corner().y()) / 2.0f);
-        int right = ceil(((float) object_detection.rect.br_corner().x()) / 2.0f);
-        int bottom = ceil(((float) object_detection.rect.br_corner().y()) / 2.0f);
+        int left = floor(object_detection.rect.tl_corner().x() / context.detection_scale);
+        int top = floor(object_detection.rect.tl_corner().y() / context.detection_scale);
+        int right = ceil(object_detection.rect.br_corner().x() / context.detection_scale);
+        int bottom = ceil(object_detection.rect.br_corner().y() / context.detection_scale);
 
-        //set to rect adjusted after pyr up
+        //set to rect adjusted after scaling
         rectangle rect_to_adjust(left, top, right, bottom);
 
         //pass ref to update
         AdjustRectToEdgesDlib(rect_to_adjust, frame_gray);
 
-        //point to the pyr up fixed and adjusted rect
+        //the scale and the pyramid only roughly limit the face size
+        if (static_cast<int>(rect_to_adjust.width()) < context.min_face_size
+            || static_cast<int>(rect_to_adjust.height()) < context.min_face_size) {
+            continue;
+        }
+        if (context.max_face_size > 0 && (static_cast<int>(rect_to_adjust.width()) > context.max_face_size
+                                          || static_cast<int>(rect_to_adjust.height()) > context.max_face_size)) {
+            continue;
+        }
+
+        //point to the scaled and adjusted rect
         object_detection.rect = rect_to_adjust;
 
-        if(imshow_on) {
-            //see what the adjusted rect looks like on a pyDown'd Mat
+        if(context.imshow_on) {
+            //see what the adjusted rect looks like on the original Mat
             cv::Rect rect(object_detection.rect.tl_corner().x(), object_detection.rect.tl_corner().y(),
                           object_detection.rect.width(), object_detection.rect.height());
             cv::rectangle(frame_gray_clone_down, rect, cv::Scalar(255,0,0));
         }
+
+        scaled_object_detections.push_back(object_detection);
     }
 
-    if(imshow_on) {
-        imshow(window_name_up, frame_gray_clone);
+    if(context.imshow_on) {
+        imshow(window_name_up, frame_gray_scaled);
         imshow(window_name_down, frame_gray_clone_down);
         waitKey(5);
     }
 
-    return object_detections;
+    return scaled_object_detections;
 }
 
 void DlibFaceDetection::LogDetection(const MPFImageLocation& face, const string& job_name) {
@@ -824,8 +966,8 @@ void DlibFaceDetection::LogDetection(const MPFImageLocation& face, const string&
     LOG4CXX_DEBUG(logger_, "[" << job_name << "] Confidence: " << face.confidence);
 }
 
-void DlibFaceDetection::CloseWindows() {
-    if(imshow_on) {
+void DlibFaceDetection::CloseWindows(const DlibFaceJobContext &context) {
+    if(context.imshow_on) {
         destroyAllWindows();
     }
 }
@@ -76,12 +76,12 @@ struct DlibTrack {
     DlibTrack() : frames_since_last_detection(0), updated(false) { }
 };
 
-class DlibFaceDetection : public MPF::COMPONENT::MPFImageAndVideoDetectionComponentAdapter {
-
-private:
-    log4cxx::LoggerPtr logger_;
-
-    dlib::frontal_face_detector dlib_face_detector;
+//the settings and tracks of a single job - the component itself only holds what is shared by all jobs, so more than
+//one job can be run at the same time
+struct DlibFaceJobContext {
+    //dlib object detectors can't be used by more than one thread at a time, so each job uses its own copy of the
+    //detector loaded by the component
+    dlib::frontal_face_detector face_detector;
 
     int verbosity;
     //part of the config but not the descriptor
@@ -93,52 +93,80 @@ private:
     float min_track_object_similarity_value;
     double min_update_correlation;
 
+    //the smallest and largest faces searched for - 0 for no max face size
+    int min_face_size;
+    int max_face_size;
+    //frames are resized by this before detection, set from the min face size
+    double detection_scale;
+
+    //faces are detected every detection_frame_interval frames - the correlation trackers carry the faces in between
+    int detection_frame_interval;
+    //detection is also run on the next frame when a tracker's update correlation drops below this
+    double redetection_update_correlation;
+
     //not added to the config
     float bb_grow_rate;
 
     std::vector<DlibTrack> current_tracks;
     std::vector<DlibTrack> saved_tracks;
 
+    explicit DlibFaceJobContext(const dlib::frontal_face_detector &face_detector) : face_detector(face_detector) { }
+};
+
+class DlibFaceDetection : public MPF::COMPONENT::MPFImageAndVideoDetectionComponentAdapter {
+
+private:
+    log4cxx::LoggerPtr logger_;
+
+    dlib::frontal_face_detector dlib_face_detector;
+
+    //the parameters read from the config file at initialization
     QHash<QString, QString> parameters;
 
-    void SetDefaultParameters();
-    void SetReadConfigParameters();
-    void GetPropertySettings(const std::map <std::string, std::string> &algorithm_properties);
+    void SetDefaultParameters(DlibFaceJobContext &context);
+    void SetReadConfigParameters(DlibFaceJobContext &context);
+    void GetPropertySettings(const std::map <std::string, std::string> &algorithm_properties,
+                             DlibFaceJobContext &context);
+    void ConfigureFaceDetector(DlibFaceJobContext &context);
 
     float GetTrackObjectSimilarity(const DlibTrack &current_track, const dlib::rectangle &new_rect);
-    bool IsObjectSimilar(const DlibTrack &current_track, const dlib::rectangle &new_rect);
+    bool IsObjectSimilar(const DlibFaceJobContext &context, const DlibTrack &current_track,
+                         const dlib::rectangle &new_rect);
     bool IsValidNewObject(const DlibTrack &current_track, const dlib::rectangle &new_rect);
 
-    int GetMostSimilarOverlappingObject(const DlibTrack &current_track,
-                                        const std::vector<dlib::rect_detection> &next_detected_objects);
+    int GetMostSimilarOverlappingObject(const DlibFaceJobContext &context, const DlibTrack &current_track,
+                                        const std::vector<dlib::rect_detection> &next_detected_objects,
+                                        const std::vector<bool> &object_used);
 
-    void CloseAnyOpenTracks();
+    void CloseAnyOpenTracks(DlibFaceJobContext &context);
 
-    void GrowRect(dlib::rectangle &rect);
+    void GrowRect(const DlibFaceJobContext &context, dlib::rectangle &rect);
     void AdjustRectToEdgesDlib(dlib::rectangle &rect, const cv::Mat &src);
 
     void LogDetection(const MPF::COMPONENT::MPFImageLocation& face,
                       const std::string& job_name);
 
-    void CloseWindows();
+    void CloseWindows(const DlibFaceJobContext &context);
 
     void DlibRectToMPFImageLocation(const dlib::rectangle &object_rect,
                                     float object_detection_confidence,
                                     MPF::COMPONENT::MPFImageLocation &mpf_object_detection);
 
-    void UpdateTracks(const dlib::cv_image<dlib::uint8> &next_frame_gray,
+    bool UpdateTracks(DlibFaceJobContext &context,
+                      const dlib::cv_image<dlib::uint8> &next_frame_gray,
                       const cv::Mat &next_frame_gray_mat,
-                      std::vector<dlib::rect_detection> &next_detected_objects,
+                      const std::vector<dlib::rect_detection> &next_detected_objects,
                       int frame_index);
 
-    std::vector<dlib::rect_detection> DetectFacesDlib(const cv::Mat &frame_gray);
+    std::vector<dlib::rect_detection> DetectFacesDlib(DlibFaceJobContext &context, const cv::Mat &frame_gray);
 
     std::vector<MPF::COMPONENT::MPFVideoTrack> GetDetectionsFromVideoCapture(
-            const MPF::COMPONENT::MPFVideoJob &job, MPF::COMPONENT::MPFVideoCapture &video_capture);
+            DlibFaceJobContext &context, const MPF::COMPONENT::MPFVideoJob &job,
+            MPF::COMPONENT::MPFVideoCapture &video_capture);
 
 
     std::vector<MPF::COMPONENT::MPFImageLocation> GetDetectionsFromImageData(
-            const MPF::COMPONENT::MPFImageJob &job, cv::Mat &image_data);
+            DlibFaceJobContext &context, const MPF::COMPONENT::MPFImageJob &job, cv::Mat &image_data);
 
 public:
 
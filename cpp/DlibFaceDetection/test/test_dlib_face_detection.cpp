@@ -25,7 +25,10 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <iostream>
+#include <sstream>
 
 #include <gtest/gtest.h>
 
@@ -39,6 +42,7 @@
 
 #include "DlibFaceDetection.h"
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
@@ -172,6 +176,192 @@ TEST(VideoGeneration, TestOnKnownVideo) {
     delete dlib_face_detection;
 }
 
+// Faces that were only carried by a correlation tracker have a confidence of 0, so the frames with a higher
+// confidence are the frames that faces were detected on.
+static std::vector<int> GetDetectedFrames(const std::vector<MPFVideoTrack> &tracks) {
+    std::vector<int> detected_frames;
+    for (const MPFVideoTrack &track : tracks) {
+        for (const auto &frame_location : track.frame_locations) {
+            if (frame_location.second.confidence > 0) {
+                detected_frames.push_back(frame_location.first);
+            }
+        }
+    }
+    std::sort(detected_frames.begin(), detected_frames.end());
+    return detected_frames;
+}
+
+TEST(VideoGeneration, TestDetectionFrameInterval) {
+
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        std::string config_path(current_path.toStdString() + "/config/test_dlib_face_config.ini");
+        int rc = LoadConfig(config_path, parameters);
+        std::cout << "Test TestDetectionFrameInterval: config file loaded response code: " << rc << std::endl;
+    }
+
+    int start = parameters["DLIB_FACE_START_FRAME"].toInt();
+    int stop = parameters["DLIB_FACE_STOP_FRAME"].toInt();
+    string inTrackFile = parameters["DLIB_FACE_KNOWN_TRACKS"].toStdString();
+    string inVideoFile = parameters["DLIB_FACE_VIDEO_FILE"].toStdString();
+    float comparison_score_threshold = parameters["DLIB_FACE_COMPARISON_SCORE_VIDEO"].toFloat();
+
+    std::vector<MPFVideoTrack> known_tracks;
+    ASSERT_TRUE(ReadDetectionsFromFile::ReadVideoTracks(inTrackFile, known_tracks));
+    ASSERT_FALSE(known_tracks.empty());
+
+    DlibFaceDetection *dlib_face_detection = new DlibFaceDetection();
+    dlib_face_detection->SetRunDirectory(current_working_dir + "/../plugin");
+    EXPECT_TRUE(dlib_face_detection->Init());
+
+    // 	Only detect faces every fifth frame - the correlation trackers should still place a face on every frame, and
+    // 	the tracks should still match the known tracks.
+    MPFVideoJob job("Testing", inVideoFile, start, stop, { {"DETECTION_FRAME_INTERVAL", "5"} }, { });
+    std::vector<MPFVideoTrack> found_tracks = dlib_face_detection->GetDetections(job);
+    ASSERT_FALSE(found_tracks.empty());
+
+    for (const MPFVideoTrack &track : found_tracks) {
+        EXPECT_EQ(static_cast<size_t>(track.stop_frame - track.start_frame + 1), track.frame_locations.size());
+    }
+
+    float comparison_score = DetectionComparison::CompareDetectionOutput(found_tracks, known_tracks);
+    cout << "Tracker comparison score with an interval of 5: " << comparison_score << endl;
+    EXPECT_GT(comparison_score, comparison_score_threshold);
+
+    // 	Start on the first frame of a known face and use an interval longer than the video, so faces are only
+    // 	detected again when REDETECTION_UPDATE_CORRELATION triggers it.
+    int face_start = known_tracks[0].start_frame;
+    for (const MPFVideoTrack &track : known_tracks) {
+        face_start = std::min(face_start, track.start_frame);
+    }
+    string long_interval = std::to_string(stop - start + 1);
+
+    // 	No update correlation is below 0, so faces are only detected on the first frame.
+    MPFVideoJob no_redetection_job("Testing", inVideoFile, face_start, stop,
+                                   { {"DETECTION_FRAME_INTERVAL", long_interval},
+                                     {"REDETECTION_UPDATE_CORRELATION", "0"} }, { });
+    std::vector<int> detected_frames = GetDetectedFrames(dlib_face_detection->GetDetections(no_redetection_job));
+    ASSERT_FALSE(detected_frames.empty());
+    EXPECT_EQ(face_start, detected_frames.front());
+    EXPECT_EQ(face_start, detected_frames.back());
+
+    // 	Every update correlation is below 1000, so faces are detected again on the frame after each update.
+    MPFVideoJob redetection_job("Testing", inVideoFile, face_start, stop,
+                                { {"DETECTION_FRAME_INTERVAL", long_interval},
+                                  {"REDETECTION_UPDATE_CORRELATION", "1000"} }, { });
+    detected_frames = GetDetectedFrames(dlib_face_detection->GetDetections(redetection_job));
+    ASSERT_FALSE(detected_frames.empty());
+    EXPECT_EQ(face_start, detected_frames.front());
+    EXPECT_GT(detected_frames.back(), face_start);
+
+    EXPECT_TRUE(dlib_face_detection->Close());
+    delete dlib_face_detection;
+}
+
+// Writes a clip that pans slowly down the multi-face test image, so that several correlation trackers are updated on
+// every frame. The faces stay inside every frame.
+static void WritePanningVideo(const std::string &image_file, const std::string &video_file, int frame_count) {
+    cv::Mat image = cv::imread(image_file);
+    ASSERT_FALSE(image.empty());
+    cv::resize(image, image, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+
+    const int step = 4;
+    cv::Size frame_size(image.cols, image.rows - step * frame_count);
+    cv::VideoWriter writer(video_file, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 10, frame_size);
+    ASSERT_TRUE(writer.isOpened());
+    for (int i = 0; i < frame_count; i++) {
+        writer.write(image(cv::Rect(cv::Point(0, step * i), frame_size)));
+    }
+}
+
+// One line per face, so that a difference between two runs shows which track and frame it is in.
+static std::vector<std::string> DescribeTracks(const std::vector<MPFVideoTrack> &tracks) {
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < tracks.size(); i++) {
+        for (const auto &frame_location : tracks[i].frame_locations) {
+            const MPFImageLocation &face = frame_location.second;
+            std::ostringstream line;
+            line << "track " << i << " (" << tracks[i].start_frame << "-" << tracks[i].stop_frame << ", "
+                 << tracks[i].confidence << ") frame " << frame_location.first << ": " << face.x_left_upper << ","
+                 << face.y_left_upper << "," << face.width << "," << face.height << " " << face.confidence;
+            lines.push_back(line.str());
+        }
+    }
+    return lines;
+}
+
+// Limits OpenCV to a single thread until it goes out of scope. cv::parallel_for_ then runs the whole range on the
+// calling thread.
+class SingleOpenCvThread {
+public:
+    SingleOpenCvThread() : num_threads_(cv::getNumThreads()) {
+        cv::setNumThreads(1);
+    }
+
+    ~SingleOpenCvThread() {
+        cv::setNumThreads(num_threads_);
+    }
+
+private:
+    int num_threads_;
+};
+
+TEST(VideoGeneration, TestParallelTrackUpdate) {
+
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        std::string config_path(current_path.toStdString() + "/config/test_dlib_face_config.ini");
+        int rc = LoadConfig(config_path, parameters);
+        std::cout << "Test TestParallelTrackUpdate: config file loaded response code: " << rc << std::endl;
+    }
+
+    char dir_template[] = "/tmp/dlib_face_test-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir_template) != NULL);
+    std::string temp_dir(dir_template);
+    std::string video_file = temp_dir + "/panning_faces.avi";
+    const int frame_count = 20;
+    ASSERT_NO_FATAL_FAILURE(WritePanningVideo(parameters["DLIB_FACE_IMAGE_FILE"].toStdString(), video_file,
+                                              frame_count));
+
+    DlibFaceDetection *dlib_face_detection = new DlibFaceDetection();
+    dlib_face_detection->SetRunDirectory(current_working_dir + "/../plugin");
+    EXPECT_TRUE(dlib_face_detection->Init());
+
+    // 	The faces in the image are large, so the frames don't need to be upsampled.
+    MPFVideoJob job("Testing", video_file, 0, frame_count - 1, { {"MIN_FACE_SIZE", "80"} }, { });
+    std::vector<MPFVideoTrack> parallel_tracks = dlib_face_detection->GetDetections(job);
+
+    // 	UpdateTracks updates all of the open trackers in one cv::parallel_for_, so more than one must be open at once.
+    int max_open_tracks = 0;
+    for (int frame = 0; frame < frame_count; frame++) {
+        int open_tracks = 0;
+        for (const MPFVideoTrack &track : parallel_tracks) {
+            if (track.frame_locations.count(frame) > 0) {
+                open_tracks++;
+            }
+        }
+        max_open_tracks = std::max(max_open_tracks, open_tracks);
+    }
+    EXPECT_GT(max_open_tracks, 1);
+
+    std::vector<MPFVideoTrack> serial_tracks;
+    {
+        SingleOpenCvThread single_thread;
+        serial_tracks = dlib_face_detection->GetDetections(job);
+    }
+    EXPECT_EQ(DescribeTracks(serial_tracks), DescribeTracks(parallel_tracks));
+
+    std::remove(video_file.c_str());
+    rmdir(temp_dir.c_str());
+
+    EXPECT_TRUE(dlib_face_detection->Close());
+    delete dlib_face_detection;
+}
+
 TEST(ImageGeneration, TestOnKnownImage) {
 
     string current_working_dir = GetCurrentWorkingDirectory();
@@ -238,3 +428,86 @@ TEST(ImageGeneration, TestOnKnownImage) {
     EXPECT_TRUE(dlib_face_detection->Close());
     delete dlib_face_detection;
 }
+
+
+TEST(ImageGeneration, TestMaxFaceSize) {
+
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        std::string config_path(current_path.toStdString() + "/config/test_dlib_face_config.ini");
+        int rc = LoadConfig(config_path, parameters);
+        std::cout << "Test TestMaxFaceSize: config file loaded response code: " << rc << std::endl;
+    }
+
+    std::string known_image_file = parameters["DLIB_FACE_IMAGE_FILE"].toStdString();
+
+    DlibFaceDetection *dlib_face_detection = new DlibFaceDetection();
+    dlib_face_detection->SetRunDirectory(current_working_dir + "/../plugin");
+    EXPECT_TRUE(dlib_face_detection->Init());
+
+    MPFImageJob job("Testing", known_image_file, { }, { });
+    std::vector<MPFImageLocation> found_detections = dlib_face_detection->GetDetections(job);
+    ASSERT_FALSE(found_detections.empty());
+
+    int max_face_size = 0;
+    for (const MPFImageLocation &detection : found_detections) {
+        max_face_size = std::max(max_face_size, std::max(detection.width, detection.height));
+    }
+
+    // 	The largest face should no longer be found once the max face size is below its size.
+    int limited_face_size = max_face_size - 1;
+    MPFImageJob limited_job("Testing", known_image_file, { {"MAX_FACE_SIZE", std::to_string(limited_face_size)} }, { });
+    std::vector<MPFImageLocation> limited_detections = dlib_face_detection->GetDetections(limited_job);
+    EXPECT_LT(limited_detections.size(), found_detections.size());
+    for (const MPFImageLocation &detection : limited_detections) {
+        EXPECT_LE(detection.width, limited_face_size);
+        EXPECT_LE(detection.height, limited_face_size);
+    }
+
+    EXPECT_TRUE(dlib_face_detection->Close());
+    delete dlib_face_detection;
+}
+
+
+TEST(ImageGeneration, TestMinFaceSizeLimit) {
+
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        std::string config_path(current_path.toStdString() + "/config/test_dlib_face_config.ini");
+        int rc = LoadConfig(config_path, parameters);
+        std::cout << "Test TestMinFaceSizeLimit: config file loaded response code: " << rc << std::endl;
+    }
+
+    std::string known_image_file = parameters["DLIB_FACE_IMAGE_FILE"].toStdString();
+
+    DlibFaceDetection *dlib_face_detection = new DlibFaceDetection();
+    dlib_face_detection->SetRunDirectory(current_working_dir + "/../plugin");
+    EXPECT_TRUE(dlib_face_detection->Init());
+
+    // 	Frames are upsampled at most 4x, so every MIN_FACE_SIZE below 20 scales frames the same way. The faces found
+    // 	at 4x are at least 20 pixels, so none of them are dropped for being smaller than MIN_FACE_SIZE.
+    MPFImageJob limit_job("Testing", known_image_file, { {"MIN_FACE_SIZE", "10"} }, { });
+    std::vector<MPFImageLocation> limit_detections = dlib_face_detection->GetDetections(limit_job);
+    ASSERT_FALSE(limit_detections.empty());
+    for (const MPFImageLocation &detection : limit_detections) {
+        EXPECT_GE(detection.width, 10);
+        EXPECT_GE(detection.height, 10);
+    }
+
+    MPFImageJob small_job("Testing", known_image_file, { {"MIN_FACE_SIZE", "1"} }, { });
+    std::vector<MPFImageLocation> small_detections = dlib_face_detection->GetDetections(small_job);
+    ASSERT_EQ(limit_detections.size(), small_detections.size());
+    for (size_t i = 0; i < small_detections.size(); i++) {
+        EXPECT_EQ(limit_detections[i].x_left_upper, small_detections[i].x_left_upper);
+        EXPECT_EQ(limit_detections[i].y_left_upper, small_detections[i].y_left_upper);
+        EXPECT_EQ(limit_detections[i].width, small_detections[i].width);
+        EXPECT_EQ(limit_detections[i].height, small_detections[i].height);
+    }
+
+    EXPECT_TRUE(dlib_face_detection->Close());
+    delete dlib_face_detection;
+}
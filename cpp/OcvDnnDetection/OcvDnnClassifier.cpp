@@ -0,0 +1,1463 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "OcvDnnClassifier.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/core/utils/filesystem.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/dnn.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <Utils.h>
+#include <detectionComponentUtils.h>
+#include <MPFDetectionException.h>
+#include <MPFInvalidPropertyException.h>
+
+
+using namespace MPF::COMPONENT;
+
+
+void OcvDnnClassifier::init(const std::string &plugin_path, const log4cxx::LoggerPtr &logger) {
+    logger_ = logger;
+    // Load model info from config file
+    // A model is defined by a txt file, a bin file, and a synset
+    models_parser_.Init(plugin_path + "/models")
+            .RegisterOptionalPathField("model_config", &ModelSettings::model_config_file)
+            .RegisterPathField("model_binary", &ModelSettings::model_binary_file)
+            .RegisterPathField("synset_txt", &ModelSettings::synset_file);
+}
+
+
+void OcvDnnClassifier::clearCaches() {
+    net_cache_.clear();
+    spectral_hash_cache_.clear();
+    spectral_hash_index_.clear();
+}
+
+
+
+// Returns 0 when the file does not exist, or when the path is empty.
+time_t getModificationTime(const std::string &path) {
+    struct stat file_status;
+    if (path.empty() || stat(path.c_str(), &file_status) != 0) {
+        return 0;
+    }
+    return file_status.st_mtime;
+}
+
+
+namespace {
+    const std::vector<std::pair<std::string, int>> DNN_BACKEND_NAMES {
+            { "DEFAULT", cv::dnn::DNN_BACKEND_DEFAULT },
+            { "OPENCV", cv::dnn::DNN_BACKEND_OPENCV },
+            { "INFERENCE_ENGINE", cv::dnn::DNN_BACKEND_INFERENCE_ENGINE },
+            { "HALIDE", cv::dnn::DNN_BACKEND_HALIDE },
+            { "VULKAN", cv::dnn::DNN_BACKEND_VKCOM }
+    };
+
+    const std::vector<std::pair<std::string, int>> DNN_TARGET_NAMES {
+            { "CPU", cv::dnn::DNN_TARGET_CPU },
+            { "OPENCL", cv::dnn::DNN_TARGET_OPENCL },
+            { "OPENCL_FP16", cv::dnn::DNN_TARGET_OPENCL_FP16 },
+            { "MYRIAD", cv::dnn::DNN_TARGET_MYRIAD },
+            { "VULKAN", cv::dnn::DNN_TARGET_VULKAN }
+    };
+
+
+    int getDnnEnumValue(const std::vector<std::pair<std::string, int>> &names, const std::string &property_name,
+                        const std::string &property_value) {
+        for (const auto &name_pair : names) {
+            if (boost::iequals(name_pair.first, property_value)) {
+                return name_pair.second;
+            }
+        }
+
+        std::vector<std::string> valid_names;
+        for (const auto &name_pair : names) {
+            valid_names.push_back(name_pair.first);
+        }
+        throw MPFInvalidPropertyException(
+                property_name,
+                "The value, \"" + property_value + "\", is not valid. Valid values are: "
+                + boost::algorithm::join(valid_names, ", ") + '.');
+    }
+
+
+    std::string getDnnEnumName(const std::vector<std::pair<std::string, int>> &names, int value) {
+        for (const auto &name_pair : names) {
+            if (name_pair.second == value) {
+                return name_pair.first;
+            }
+        }
+        return std::to_string(value);
+    }
+
+
+    std::string base64Encode(const unsigned char *data, size_t length) {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string encoded;
+        encoded.reserve(((length + 2) / 3) * 4);
+        size_t i = 0;
+        for (; i + 2 < length; i += 3) {
+            unsigned int triple = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+            encoded += alphabet[(triple >> 18) & 0x3F];
+            encoded += alphabet[(triple >> 12) & 0x3F];
+            encoded += alphabet[(triple >> 6) & 0x3F];
+            encoded += alphabet[triple & 0x3F];
+        }
+        if (i < length) {
+            unsigned int triple = data[i] << 16;
+            if (i + 1 < length) {
+                triple |= data[i + 1] << 8;
+            }
+            encoded += alphabet[(triple >> 18) & 0x3F];
+            encoded += alphabet[(triple >> 12) & 0x3F];
+            encoded += i + 1 < length ? alphabet[(triple >> 6) & 0x3F] : '=';
+            encoded += '=';
+        }
+        return encoded;
+    }
+}
+
+
+void OcvDnnClassifier::addToTrack(const std::string &classification_type, MPFImageLocation &location,
+                                  int frame_index, MPFVideoTrack &track) {
+    track.stop_frame = frame_index;
+    if (location.confidence > track.confidence) {
+        track.confidence = location.confidence;
+        track.detection_properties[classification_type] = location.detection_properties[classification_type];
+    }
+    track.frame_locations[frame_index] = std::move(location);
+}
+
+
+void OcvDnnClassifier::defaultTracker(const std::string &classification_type, MPFImageLocation &location,
+                                      int frame_index, std::vector<MPFVideoTrack> &tracks) {
+    bool should_start_new_track = tracks.empty()
+                               || tracks.back().detection_properties[classification_type]
+                                  != location.detection_properties[classification_type];
+
+    if (should_start_new_track) {
+        tracks.emplace_back(frame_index, frame_index, location.confidence,
+                            Properties{ { classification_type, location.detection_properties[classification_type] } });
+    }
+    addToTrack(classification_type, location, frame_index, tracks.back());
+}
+
+
+//-----------------------------------------------------------------------------
+void OcvDnnClassifier::getTopNClasses(const cv::Mat &prob_blob,
+                                     int num_classes, double threshold,
+                                     std::vector< std::pair<int, float> > &classes) const {
+
+    LOG4CXX_DEBUG(logger_, "prob blob mat rows = " << prob_blob.rows << " cols = " << prob_blob.cols);
+
+    // The blob is usually a view into the network output for a whole batch of frames, so it is read in place
+    // rather than copied.
+    cv::Mat prob_mat = prob_blob.reshape(1, 1); // reshape the blob to 1x1000 matrix (googlenet)
+
+    LOG4CXX_DEBUG(logger_, "reshaped prob blob mat rows = " << prob_mat.rows << " cols = " << prob_mat.cols);
+
+    // Only the classes above the confidence threshold need to be ranked, and only the top num_classes of those
+    // need to be sorted.
+    const float *probs = prob_mat.ptr<float>(0);
+    size_t first_new_class = classes.size();
+    for (int idx = 0; idx < prob_mat.cols; idx++) {
+        if (probs[idx] >= threshold) {
+            classes.emplace_back(idx, probs[idx]);
+        }
+    }
+
+    auto higher_confidence = [](const std::pair<int, float> &a, const std::pair<int, float> &b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    };
+
+    auto begin = classes.begin() + first_new_class;
+    if (classes.end() - begin > num_classes) {
+        std::nth_element(begin, begin + num_classes, classes.end(), higher_confidence);
+        classes.erase(begin + num_classes, classes.end());
+        begin = classes.begin() + first_new_class;
+    }
+    std::sort(begin, classes.end(), higher_confidence);
+}
+
+
+
+std::unique_ptr<MPFImageLocation> OcvDnnClassifier::getDetection(OcvDnnJobConfig &config,
+                                                                 const cv::Mat &input_frame) {
+    std::vector<NetworkOutput> network_outputs;
+    getNetworkOutput(config, { preprocessFrame(config, input_frame) }, network_outputs);
+    return createDetection(config, input_frame.size(), -1, network_outputs.front());
+}
+
+
+
+std::unique_ptr<MPFImageLocation> OcvDnnClassifier::createDetection(OcvDnnJobConfig &config,
+                                                                    const cv::Size &frame_size,
+                                                                    int frame_index,
+                                                                    NetworkOutput &network_output) {
+    const cv::Mat &prob = network_output.prob;
+    const auto &activation_layer_mats = network_output.activation_layer_mats;
+    const auto &spectral_hash_mats = network_output.spectral_hash_mats;
+
+    LOG4CXX_DEBUG(logger_, "output prob mat rows = " << prob.rows << " cols = " << prob.cols);
+    LOG4CXX_DEBUG(logger_, "output prob mat total: " << prob.total());
+
+    // The number of classifications requested must be greater
+    // than 0 and less than the total size of the output blob.
+    if ((config.number_of_classifications <= 0) || (config.number_of_classifications > prob.total())) {
+        throw MPFDetectionException(
+                MPF_INVALID_PROPERTY,
+                "Number of classifications requested: " +  std::to_string(config.number_of_classifications) +
+                " is invalid. It must be greater than 0, and less than the total returned by the net output layer = "
+                + std::to_string(prob.total()));
+    }
+
+    std::vector<std::pair<int, float>> class_info;
+    getTopNClasses(network_output.prob, config.number_of_classifications, config.confidence_threshold, class_info);
+
+    if (class_info.empty() && activation_layer_mats.empty() && spectral_hash_mats.empty()) {
+        return nullptr;
+    }
+
+
+    std::unique_ptr<MPFImageLocation> location(
+            new MPFImageLocation(0, 0, frame_size.width, frame_size.height));
+
+    if (!class_info.empty()) {
+        // Save the highest confidence classification and its corresponding confidence
+        // as the MPFImageLocation confidence.
+        LOG4CXX_DEBUG(logger_, "class id #0: " << class_info[0].first);
+        LOG4CXX_DEBUG(logger_, "confidence: " << class_info[0].second);
+        location->confidence =  class_info[0].second;
+        location->detection_properties[config.classification_type] = config.class_names->at(class_info[0].first);
+
+        // Begin accumulating the classifications in a stringstream for the classification list.
+        std::stringstream ss_ids;
+        ss_ids << config.class_names->at(class_info[0].first);
+
+        // Use another stringstream for the classification confidence list.
+        std::stringstream ss_conf;
+        ss_conf << class_info[0].second;
+
+        for (int i = 1; i < class_info.size(); i++) {
+            LOG4CXX_DEBUG(logger_, "class id #" << i << ": " << class_info[i].first);
+            LOG4CXX_DEBUG(logger_, "confidence: " << class_info[i].second);
+            ss_ids << "; " << config.class_names->at(class_info[i].first);
+            ss_conf << "; " << class_info[i].second;
+        }
+        location->detection_properties[config.classification_type + " LIST"] = ss_ids.str();
+        location->detection_properties[config.classification_type + " CONFIDENCE LIST"] = ss_conf.str();
+    }
+
+    addActivationLayerInfo(config, activation_layer_mats, location->detection_properties);
+    addSpectralHashInfo(config, spectral_hash_mats, frame_index, location->detection_properties);
+
+    return location;
+}
+
+
+
+void OcvDnnClassifier::addActivationLayerInfo(OcvDnnClassifier::OcvDnnJobConfig &config,
+                                             const std::vector<std::pair<std::string, cv::Mat>> &activation_layer_mats,
+                                             MPF::COMPONENT::Properties &detection_properties) {
+
+    for (const auto &activation_pair : activation_layer_mats) {
+        std::string name = activation_pair.first;
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        name += " ACTIVATION MATRIX";
+        detection_properties[name] = config.encodeActivationMatrix(activation_pair.first, activation_pair.second);
+    }
+
+    if (!config.bad_activation_layer_names.empty()) {
+        detection_properties["INVALID ACTIVATION LAYER LIST"] = boost::algorithm::join(config.bad_activation_layer_names, "; ");
+    }
+}
+
+
+
+void OcvDnnClassifier::addSpectralHashInfo(OcvDnnClassifier::OcvDnnJobConfig &config,
+                                           const std::vector<std::pair<SpectralHashInfo, cv::Mat>> &spectral_hash_mats,
+                                           int frame_index,
+                                           Properties &detection_properties) {
+
+    for (const auto& hash_info_pair : spectral_hash_mats) {
+        try {
+            const SpectralHashInfo &hash_info = hash_info_pair.first;
+            std::vector<uint64_t> hash = computeSpectralHash(hash_info_pair.second, hash_info);
+            int nbits = hash_info.modes.rows;
+
+            std::string name_prefix(hash_info.layer_name);
+            std::transform(name_prefix.begin(), name_prefix.end(), name_prefix.begin(), ::toupper);
+            detection_properties.emplace(name_prefix + " SPECTRAL HASH VALUE", formatSpectralHash(hash, nbits));
+
+            if (!config.spectral_hash_index_file.empty()) {
+                std::string id = config.media_path;
+                if (frame_index >= 0) {
+                    id += '#' + std::to_string(frame_index);
+                }
+                std::vector<SpectralHashIndex::Neighbor> neighbors = spectral_hash_index_.findNeighborsAndAdd(
+                        config.spectral_hash_index_file, hash_info.model_name + '/' + hash_info.layer_name, nbits,
+                        hash, id, config.spectral_hash_neighbor_count, config.spectral_hash_max_neighbor_distance);
+
+                std::stringstream ss_ids;
+                std::stringstream ss_distances;
+                for (int i = 0; i < neighbors.size(); i++) {
+                    if (i > 0) {
+                        ss_ids << "; ";
+                        ss_distances << "; ";
+                    }
+                    ss_ids << neighbors[i].id;
+                    ss_distances << neighbors[i].distance;
+                }
+                detection_properties[name_prefix + " SPECTRAL HASH NEIGHBOR LIST"] = ss_ids.str();
+                detection_properties[name_prefix + " SPECTRAL HASH NEIGHBOR DISTANCE LIST"] = ss_distances.str();
+            }
+        } catch (const cv::Exception &err) {
+            LOG4CXX_ERROR(logger_, "OpenCV exception caught while calculating the spectral hash for layer \""
+                          << hash_info_pair.first.layer_name << "\" in model named \""
+                          << hash_info_pair.first.model_name << "\": " << err.what());
+            const std::string &bad_file_name = hash_info_pair.first.file_name;
+            if (std::find(config.bad_hash_file_names.begin(),
+                          config.bad_hash_file_names.end(),
+                          bad_file_name) == config.bad_hash_file_names.end()) {
+                config.bad_hash_file_names.push_back(bad_file_name);
+            }
+        }
+    }
+
+    if (!config.bad_hash_file_names.empty()) {
+        detection_properties["INVALID SPECTRAL HASH FILENAME LIST"]
+                = boost::algorithm::join(config.bad_hash_file_names, "; ");
+    }
+}
+
+
+
+std::vector<uint64_t> OcvDnnClassifier::computeSpectralHash(const cv::Mat &activations,
+                                                           const SpectralHashInfo &hash_info) const {
+    // Bit r of the hash is 1 when the product of cos(pi * modes(r, c) * u(c)) over all columns c is positive,
+    // where u is the projected activations scaled to the training range. cos(pi * v) is positive when v rounds to
+    // an even integer, so the sign of the product is the parity of the sum of the rounded values. That lets us
+    // avoid calling cos() and use OpenCV's vectorized rounding instead.
+    cv::Mat scaled_projection;
+    cv::divide((activations * hash_info.pc) - hash_info.mn, hash_info.mx - hash_info.mn, scaled_projection);
+
+    cv::Mat half_periods;
+    cv::Mat(hash_info.modes.mul(cv::repeat(scaled_projection, hash_info.modes.rows, 1)))
+            .convertTo(half_periods, CV_32S);
+
+    if (hash_info.nbits != half_periods.rows) {
+        LOG4CXX_WARN(logger_, "Number of bits in the spectral hash for layer \"" << hash_info.layer_name
+                     << "\" in model named \"" << hash_info.model_name
+                     << "\" is not equal to the input nbits value: nbits = " << hash_info.nbits
+                     << ", spectral hash size = " << half_periods.rows);
+    }
+
+    std::vector<uint64_t> hash((half_periods.rows + 63) / 64, 0);
+    for (int r = 0; r < half_periods.rows; r++) {
+        const int *row = half_periods.ptr<int>(r);
+        int parity = 0;
+        for (int c = 0; c < half_periods.cols; c++) {
+            parity ^= row[c];
+        }
+        if ((parity & 1) == 0) {
+            hash[r / 64] |= uint64_t{1} << (r % 64);
+        }
+    }
+    return hash;
+}
+
+
+std::string OcvDnnClassifier::formatSpectralHash(const std::vector<uint64_t> &hash, int nbits) {
+    std::string bitset(nbits, '0');
+    for (int i = 0; i < nbits; i++) {
+        if ((hash[i / 64] >> (i % 64)) & 1) {
+            bitset[i] = '1';
+        }
+    }
+    return bitset;
+}
+
+
+cv::Mat OcvDnnClassifier::preprocessFrame(const OcvDnnClassifier::OcvDnnJobConfig &config,
+                                          const cv::Mat &input_frame) {
+    cv::Mat frame;
+    cv::resize(input_frame, frame, config.resize_size);
+
+    cv::Rect roi(config.crop_size, frame.size() - (config.crop_size * 2));
+    return frame(roi);
+}
+
+
+namespace {
+    // Returns the part of a batched network output blob that corresponds to a single image in the batch. The
+    // returned blob has the same shape it would have had if the image were passed to the network by itself.
+    cv::Mat getBatchItem(const cv::Mat &batch_blob, int batch_index) {
+        std::vector<cv::Range> ranges(batch_blob.dims, cv::Range::all());
+        ranges[0] = cv::Range(batch_index, batch_index + 1);
+        return batch_blob(ranges);
+    }
+}
+
+
+void OcvDnnClassifier::getNetworkOutput(OcvDnnClassifier::OcvDnnJobConfig &config,
+                                        const std::vector<cv::Mat> &preprocessed_frames,
+                                        std::vector<NetworkOutput> &network_outputs) {
+    // convert Mats to batch of images (BGR)
+    cv::Mat input_blob = cv::dnn::blobFromImages(preprocessed_frames, 1.0, cv::Size(), config.subtract_colors,
+                                                 false); // swapRB = false
+
+    config.net.setInput(input_blob, config.model_input_name);
+
+
+    std::vector<cv::Mat> net_output;
+    config.net.forward(net_output, config.output_layers);
+    assert(net_output.size() == 1 + config.requested_activation_layer_names.size() + config.spectral_hash_info.size());
+
+    int batch_size = preprocessed_frames.size();
+    network_outputs.clear();
+    network_outputs.resize(batch_size);
+    for (int i = 0; i < batch_size; i++) {
+        NetworkOutput &network_output = network_outputs[i];
+        auto net_out_iter = net_output.begin();
+        network_output.prob = getBatchItem(*net_out_iter++, i);
+
+        for (const auto &layer_name : config.requested_activation_layer_names) {
+            network_output.activation_layer_mats.emplace_back(layer_name, getBatchItem(*net_out_iter++, i));
+        }
+
+        for (const auto &hash_info : config.spectral_hash_info) {
+            network_output.spectral_hash_mats.emplace_back(hash_info, getBatchItem(*net_out_iter++, i));
+        }
+    }
+}
+
+
+OcvDnnClassifier::OcvDnnJobConfig::OcvDnnJobConfig(const Properties &props, OcvDnnClassifier &classifier) {
+    const log4cxx::LoggerPtr &logger = classifier.logger_;
+
+    using namespace DetectionComponentUtils;
+
+    const std::string &model_name = GetProperty<std::string>(props,
+                                                             "MODEL_NAME",
+                                                             "googlenet");
+    const std::string &models_dir_path = GetProperty<std::string>(props,
+                                                                  "MODELS_DIR_PATH",
+                                                                  ".");
+    ModelSettings settings = classifier.models_parser_.ParseIni(model_name,
+                                                               models_dir_path + "/OcvDnnDetection");
+
+    LOG4CXX_INFO(logger, "Get detections using model: " << model_name);
+
+    resize_size = cv::Size(GetProperty(props, "RESIZE_WIDTH", 224), GetProperty(props, "RESIZE_HEIGHT", 224));
+
+    crop_size = cv::Size(GetProperty(props, "LEFT_AND_RIGHT_CROP", 0), GetProperty(props, "TOP_AND_BOTTOM_CROP", 0));
+
+    subtract_colors = cv::Scalar(GetProperty(props, "SUBTRACT_BLUE_VALUE", 0.0),
+                                 GetProperty(props, "SUBTRACT_GREEN_VALUE", 0.0),
+                                 GetProperty(props, "SUBTRACT_RED_VALUE", 0.0));
+
+    model_input_name = GetProperty(props, "MODEL_INPUT_NAME", std::string("data"));
+    model_output_layer = GetProperty(props, "MODEL_OUTPUT_LAYER", std::string("prob"));
+
+
+    int dnn_backend;
+    int dnn_target;
+    std::string dnn_backend_name = GetProperty(props, "DNN_BACKEND", std::string("DEFAULT"));
+    if (boost::iequals(dnn_backend_name, "AUTO")) {
+        std::string cache_file_path = GetProperty(props, "DNN_BACKEND_BENCHMARK_FILE",
+                                                  std::string("$MPF_HOME/share/tmp/ocv_dnn_backend_benchmarks.json"));
+        if (!cache_file_path.empty()) {
+            std::string expanded_file_path;
+            std::string error = Utils::expandFileName(cache_file_path, expanded_file_path);
+            if (error.empty()) {
+                cache_file_path = expanded_file_path;
+            }
+            else {
+                // The benchmark results are only kept in memory, so the benchmark will run again in the next process.
+                LOG4CXX_WARN(logger, "Expansion of the DNN_BACKEND_BENCHMARK_FILE \"" << cache_file_path
+                                     << "\" failed: error reported was \"" << error << "\"");
+                cache_file_path.clear();
+            }
+        }
+        std::tie(dnn_backend, dnn_target) = classifier.backend_benchmark_cache_.getFastestBackend(
+                settings, resize_size - (crop_size * 2), model_input_name, model_output_layer, cache_file_path,
+                logger);
+    }
+    else {
+        dnn_backend = getDnnEnumValue(DNN_BACKEND_NAMES, "DNN_BACKEND", dnn_backend_name);
+        dnn_target = getDnnEnumValue(DNN_TARGET_NAMES, "DNN_TARGET",
+                                     GetProperty(props, "DNN_TARGET", std::string("CPU")));
+    }
+    LOG4CXX_DEBUG(logger, "Using DNN backend " << getDnnEnumName(DNN_BACKEND_NAMES, dnn_backend)
+                          << " and DNN target " << getDnnEnumName(DNN_TARGET_NAMES, dnn_target));
+
+    cached_net = classifier.net_cache_.checkout(settings, dnn_backend, dnn_target, logger);
+    // cv::dnn::Net is a reference counted handle, so this does not copy the network.
+    net = cached_net->net;
+    class_names = cached_net->class_names;
+
+
+    const std::vector<cv::String> &net_layer_names = cached_net->layer_names;
+
+    bool output_layer_missing = std::find(net_layer_names.begin(), net_layer_names.end(), model_output_layer)
+                                    == net_layer_names.end();
+    if (output_layer_missing) {
+        throw MPFDetectionException(MPF_INVALID_PROPERTY,
+                                "The requested output layer: " + model_output_layer + " does not exist");
+    }
+
+
+    validateLayerNames(
+            GetProperty(props, "ACTIVATION_LAYER_LIST", std::string()),
+            net_layer_names, model_name, logger);
+
+    getSpectralHashInfo(
+            GetProperty(props, "SPECTRAL_HASH_FILE_LIST", std::string()),
+            net_layer_names, model_name, classifier.spectral_hash_cache_, logger);
+
+    spectral_hash_neighbor_count = GetProperty(props, "SPECTRAL_HASH_NEIGHBOR_COUNT", 5);
+    spectral_hash_max_neighbor_distance = GetProperty(props, "SPECTRAL_HASH_MAX_NEIGHBOR_DISTANCE", 8);
+    std::string index_file = GetProperty(props, "SPECTRAL_HASH_INDEX_FILE", std::string());
+    if (!index_file.empty() && !spectral_hash_info.empty()) {
+        std::string error = Utils::expandFileName(index_file, spectral_hash_index_file);
+        if (!error.empty()) {
+            throw MPFInvalidPropertyException(
+                    "SPECTRAL_HASH_INDEX_FILE",
+                    "The value, \"" + index_file + "\", could not be expanded due to: " + error);
+        }
+    }
+
+
+    output_layers.reserve(1 + requested_activation_layer_names.size() + spectral_hash_info.size());
+    output_layers.emplace_back(model_output_layer);
+    output_layers.insert(output_layers.end(),
+                         requested_activation_layer_names.begin(), requested_activation_layer_names.end());
+    for (const auto &hash_info : spectral_hash_info) {
+        output_layers.emplace_back(hash_info.layer_name);
+    }
+
+    number_of_classifications = GetProperty(props, "NUMBER_OF_CLASSIFICATIONS", 1);
+    if (number_of_classifications < 1) {
+        throw MPFInvalidPropertyException(
+                "NUMBER_OF_CLASSIFICATIONS",
+                "The value, " + std::to_string(number_of_classifications) + ", is not valid. It must be greater than 0.");
+    }
+    confidence_threshold = GetProperty(props, "CONFIDENCE_THRESHOLD", 0.0);
+    classification_type = GetProperty(props, "CLASSIFICATION_TYPE", "CLASSIFICATION");
+
+    std::string output_format = GetProperty(props, "ACTIVATION_OUTPUT_FORMAT", std::string("JSON"));
+    if (boost::iequals(output_format, "JSON")) {
+        activation_output_format = ActivationOutputFormat::JSON;
+    }
+    else if (boost::iequals(output_format, "BASE64")) {
+        activation_output_format = ActivationOutputFormat::BASE64;
+    }
+    else if (boost::iequals(output_format, "FILE")) {
+        activation_output_format = ActivationOutputFormat::FILE;
+    }
+    else {
+        throw MPFInvalidPropertyException(
+                "ACTIVATION_OUTPUT_FORMAT",
+                "The value, \"" + output_format + "\", is not valid. Only \"JSON\", \"BASE64\", and \"FILE\" are accepted.");
+    }
+
+    std::string output_precision = GetProperty(props, "ACTIVATION_OUTPUT_PRECISION", std::string("FLOAT32"));
+    if (boost::iequals(output_precision, "FLOAT32")) {
+        activation_output_fp16 = false;
+    }
+    else if (boost::iequals(output_precision, "FLOAT16")) {
+        activation_output_fp16 = true;
+    }
+    else {
+        throw MPFInvalidPropertyException(
+                "ACTIVATION_OUTPUT_PRECISION",
+                "The value, \"" + output_precision + "\", is not valid. Only \"FLOAT32\" and \"FLOAT16\" are accepted.");
+    }
+
+    if (activation_output_format == ActivationOutputFormat::FILE && !requested_activation_layer_names.empty()) {
+        std::string output_directory = GetProperty(props, "ACTIVATION_OUTPUT_DIRECTORY",
+                                                   std::string("$MPF_HOME/share/tmp/OcvDnnDetection"));
+        std::string error = Utils::expandFileName(output_directory, activation_output_directory);
+        if (!error.empty()) {
+            throw MPFInvalidPropertyException(
+                    "ACTIVATION_OUTPUT_DIRECTORY",
+                    "The value, \"" + output_directory + "\", could not be expanded due to: " + error);
+        }
+    }
+
+    batch_size = GetProperty(props, "BATCH_SIZE", 1);
+    if (batch_size < 1) {
+        throw MPFInvalidPropertyException(
+                "BATCH_SIZE",
+                "The value, " + std::to_string(batch_size) + ", is not valid. It must be greater than 0.");
+    }
+
+    frame_queue_capacity = GetProperty(props, "FRAME_QUEUE_CAPACITY", 4);
+    if (frame_queue_capacity < 1) {
+        throw MPFInvalidPropertyException(
+                "FRAME_QUEUE_CAPACITY",
+                "The value, " + std::to_string(frame_queue_capacity) + ", is not valid. It must be greater than 0.");
+    }
+
+    frame_difference_threshold = GetProperty(props, "FRAME_DIFFERENCE_THRESHOLD", 0.0);
+    max_skipped_frames = GetProperty(props, "MAX_SKIPPED_FRAMES", 30);
+    if (max_skipped_frames < 0) {
+        throw MPFInvalidPropertyException(
+                "MAX_SKIPPED_FRAMES",
+                "The value, " + std::to_string(max_skipped_frames) + ", is not valid. It must not be negative.");
+    }
+
+    feed_forward_classification_interval = GetProperty(props, "FEED_FORWARD_CLASSIFICATION_INTERVAL", 1);
+    if (feed_forward_classification_interval < 1) {
+        throw MPFInvalidPropertyException(
+                "FEED_FORWARD_CLASSIFICATION_INTERVAL",
+                "The value, " + std::to_string(feed_forward_classification_interval)
+                + ", is not valid. It must be greater than 0.");
+    }
+
+    preprocessing_thread_count = GetProperty(props, "PREPROCESSING_THREAD_COUNT", 1);
+    if (preprocessing_thread_count < 1) {
+        throw MPFInvalidPropertyException(
+                "PREPROCESSING_THREAD_COUNT",
+                "The value, " + std::to_string(preprocessing_thread_count) + ", is not valid. It must be greater than 0.");
+    }
+}
+
+
+
+std::vector<std::string> OcvDnnClassifier::NetCache::readClassNames(const std::string &synset_file) {
+    std::ifstream fp(synset_file);
+    if (!fp.is_open()) {
+        throw MPFDetectionException(
+                MPF_COULD_NOT_OPEN_DATAFILE,
+                "Failed to open the synset file that was expected to be located at: " + synset_file);
+    }
+
+    std::vector<std::string> class_names;
+    std::string name;
+    while (std::getline(fp, name))
+    {
+        if (name.length()) {
+            class_names.push_back(name.substr(name.find(' ') + 1));
+        }
+    }
+    fp.close();
+
+    if (class_names.empty()) {
+        throw MPFDetectionException(MPF_DETECTION_FAILED, "No network class labels found.");
+    }
+    return class_names;
+}
+
+
+
+void OcvDnnClassifier::OcvDnnJobConfig::validateLayerNames(std::string requested_activation_layers,
+                                                         const std::vector<cv::String> &net_layers,
+                                                         const std::string &model_name,
+                                                         const log4cxx::LoggerPtr &logger) {
+    // Get the layers in the net and check that each layer
+    // requested is actually part of the net. If it is, add it to the
+    // vector of layer names for which we need the layer output. If
+    // not, remember the name so that we can indicate in the output
+    // that it was not found.
+
+    if (!requested_activation_layers.empty()) {
+        boost::trim(requested_activation_layers);
+        std::vector<std::string> names;
+        boost::split(names, requested_activation_layers,
+                     boost::is_any_of(" ;"),
+                     boost::token_compress_on);
+        for (const std::string &name : names) {
+            if (!name.empty()) {
+                if (std::find(net_layers.begin(), net_layers.end(), name) != net_layers.end()) {
+                    requested_activation_layer_names.push_back(name);
+                }
+                else {
+                    LOG4CXX_WARN(logger, "Layer named \"" << name << "\" was not found in model named \""
+                                                          << model_name << "\"");
+                    bad_activation_layer_names.push_back(name);
+                }
+            }
+        }
+    }
+}
+
+
+bool OcvDnnClassifier::SpectralHashCache::parseAndValidateHashInfo(const std::string &file_name,
+                                                                  cv::FileStorage &sp_params,
+                                                                  SpectralHashInfo &hash_info,
+                                                                  const log4cxx::LoggerPtr &logger) {
+    bool is_good_file_name = true;
+
+    if (sp_params["nbits"].empty()) {
+        LOG4CXX_WARN(logger, "The \"nbits\" field in file \"" << file_name << "\" is missing.");
+        is_good_file_name = false;
+    }
+    else {
+        sp_params["nbits"] >> hash_info.nbits;
+        if (hash_info.nbits <= 0) {
+            LOG4CXX_WARN(logger, "The \"nbits\" value in file \"" << file_name << "\" is less than or equal to zero.");
+            is_good_file_name = false;
+        }
+    }
+
+    if (sp_params["mx"].empty()) {
+        LOG4CXX_WARN(logger, "The \"mx\" field in file \"" << file_name << "\" is missing.");
+        is_good_file_name = false;
+    }
+    else {
+        sp_params["mx"] >> hash_info.mx;
+        if (hash_info.mx.empty()) {
+            LOG4CXX_WARN(logger, "The \"mx\" matrix in file \"" << file_name << "\" is empty.");
+            is_good_file_name = false;
+        }
+    }
+    if (sp_params["mn"].empty()) {
+        LOG4CXX_WARN(logger, "The \"mn\" field in file \"" << file_name << "\" is missing.");
+        is_good_file_name = false;
+    }
+    else {
+        sp_params["mn"] >> hash_info.mn;
+        if (hash_info.mn.empty()) {
+            LOG4CXX_WARN(logger, "The \"mn\" matrix in file \"" << file_name << "\" is empty.");
+            is_good_file_name = false;
+        }
+    }
+    if (sp_params["modes"].empty()) {
+        LOG4CXX_WARN(logger, "The \"modes\" field in file \"" << file_name << "\" is missing.");
+        is_good_file_name = false;
+    }
+    else {
+        sp_params["modes"] >> hash_info.modes;
+        if (hash_info.modes.empty()) {
+            LOG4CXX_WARN(logger, "The \"modes\" matrix in file \"" << file_name << "\" is empty.");
+            is_good_file_name = false;
+        }
+    }
+    if(sp_params["pc"].empty()) {
+        LOG4CXX_WARN(logger, "The \"pc\" field in file \"" << file_name << "\" is missing.");
+        is_good_file_name = false;
+    }
+    else {
+        sp_params["pc"] >> hash_info.pc;
+        if (hash_info.pc.empty()) {
+            LOG4CXX_WARN(logger, "The \"pc\" matrix in file \"" << file_name << "\" is empty.");
+            is_good_file_name = false;
+        }
+    }
+    sp_params.release();
+
+    return is_good_file_name;
+}
+
+
+void OcvDnnClassifier::OcvDnnJobConfig::getSpectralHashInfo(std::string hash_file_list,
+                                                          const std::vector<cv::String> &net_layers,
+                                                          const std::string &model_name,
+                                                          SpectralHashCache &spectral_hash_cache,
+                                                          const log4cxx::LoggerPtr &logger) {
+    LOG4CXX_DEBUG(logger, "Loading spectral hash parameters");
+    if (!hash_file_list.empty()) {
+        boost::trim(hash_file_list);
+        std::vector<std::string> files;
+        boost::split(files, hash_file_list,
+                     boost::is_any_of(" ;"),
+                     boost::token_compress_on);
+
+        for (const std::string &file_name : files) {
+            LOG4CXX_DEBUG(logger, "file_name = " << file_name);
+            std::string err_string;
+            std::string exp_filename;
+            err_string = Utils::expandFileName(file_name, exp_filename);
+            if (!err_string.empty()) {
+                LOG4CXX_WARN(logger, "Expansion of spectral hash input filename \"" << file_name << "\" failed: error reported was \"" << err_string << "\"");
+                bad_hash_file_names.push_back(file_name);
+                continue;
+            }
+
+            std::shared_ptr<const SpectralHashInfo> cached_hash_info
+                    = spectral_hash_cache.get(file_name, exp_filename, logger);
+            if (!cached_hash_info) {
+                bad_hash_file_names.push_back(file_name);
+            }
+            else if (std::find(net_layers.begin(),
+                               net_layers.end(),
+                               cached_hash_info->layer_name) != net_layers.end()) {
+                // Everything checks out ok, so save the hash info and the
+                // layer name. Also save the original file name in case
+                // there is a subsequent error in the spectral hash
+                // calculation; we can then add the file to the list of
+                // bad files.
+                SpectralHashInfo hash_info = *cached_hash_info;
+                hash_info.file_name = file_name;
+                hash_info.model_name = model_name;
+                spectral_hash_info.push_back(std::move(hash_info));
+            }
+            else {
+                LOG4CXX_WARN(logger, "Layer named \"" << cached_hash_info->layer_name
+                             << "\" from spectral hash file \"" << file_name
+                             << "\" was not found in the model named \"" << model_name << "\"");
+                bad_hash_file_names.push_back(file_name);
+            }
+        }
+    }
+}
+
+
+
+OcvDnnClassifier::NetCache::NetPtr OcvDnnClassifier::NetCache::checkout(const ModelSettings &settings,
+                                                                        int dnn_backend, int dnn_target,
+                                                                        const log4cxx::LoggerPtr &logger) {
+    Key key(settings.model_binary_file, settings.model_config_file, settings.synset_file, dnn_backend, dnn_target);
+    time_t mod_time = std::max({ getModificationTime(settings.model_binary_file),
+                                 getModificationTime(settings.model_config_file),
+                                 getModificationTime(settings.synset_file) });
+
+    std::unique_ptr<CachedNet> cached_net;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto entry_iter = entries_.find(key);
+        if (entry_iter != entries_.end()) {
+            Entry &entry = entry_iter->second;
+            if (entry.mod_time != mod_time) {
+                LOG4CXX_DEBUG(logger, "The model files were modified since they were last loaded. "
+                                      "Discarding cached networks.");
+                entries_.erase(entry_iter);
+            }
+            else if (!entry.available_nets.empty()) {
+                cached_net = std::move(entry.available_nets.back());
+                entry.available_nets.pop_back();
+            }
+        }
+    }
+
+    if (cached_net) {
+        LOG4CXX_DEBUG(logger, "Using cached neural network");
+    }
+    else {
+        cached_net.reset(new CachedNet());
+        cached_net->class_names = std::make_shared<const std::vector<std::string>>(
+                readClassNames(settings.synset_file));
+
+        // Import the model
+        // For models that do not support or require a config file, ModelsIniParser
+        // will assign the empty string as default to settings.model_config_file.
+        // OpenCV DNN's readNet ignores the config file when it is passed an empty
+        // string path, so we need not check whether the file exists.
+        cached_net->net = cv::dnn::readNet(settings.model_binary_file, settings.model_config_file);
+        if (cached_net->net.empty()) {
+            throw MPFDetectionException(
+                    MPF_DETECTION_NOT_INITIALIZED,
+                    "Can't load the network specified by the model_config (" + settings.model_binary_file
+                    + ") and model_binary (" + settings.model_binary_file + ").");
+        }
+        cached_net->net.setPreferableBackend(dnn_backend);
+        cached_net->net.setPreferableTarget(dnn_target);
+        cached_net->layer_names = cached_net->net.getLayerNames();
+
+        LOG4CXX_DEBUG(logger, "Created neural network");
+    }
+
+    return NetPtr(cached_net.release(), [this, key, mod_time](CachedNet *net) {
+        checkin(key, mod_time, net);
+    });
+}
+
+
+void OcvDnnClassifier::NetCache::checkin(const Key &key, time_t mod_time, CachedNet *cached_net) {
+    std::unique_ptr<CachedNet> owned_net(cached_net);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry_iter = entries_.find(key);
+    if (entry_iter == entries_.end() || entry_iter->second.mod_time < mod_time) {
+        Entry &entry = entries_[key];
+        entry.mod_time = mod_time;
+        entry.available_nets.clear();
+        entry.available_nets.push_back(std::move(owned_net));
+    }
+    else if (entry_iter->second.mod_time == mod_time) {
+        entry_iter->second.available_nets.push_back(std::move(owned_net));
+    }
+    // Otherwise, the model files were modified while the network was checked out, so it is discarded.
+}
+
+
+void OcvDnnClassifier::NetCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+
+
+std::shared_ptr<const SpectralHashInfo> OcvDnnClassifier::SpectralHashCache::get(const std::string &file_name,
+                                                                                const std::string &expanded_path,
+                                                                                const log4cxx::LoggerPtr &logger) {
+    time_t mod_time = getModificationTime(expanded_path);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto entry_iter = entries_.find(expanded_path);
+        if (entry_iter != entries_.end() && entry_iter->second.mod_time == mod_time) {
+            return entry_iter->second.hash_info;
+        }
+    }
+
+    std::shared_ptr<const SpectralHashInfo> hash_info = load(file_name, expanded_path, logger);
+    if (hash_info) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[expanded_path] = { mod_time, hash_info };
+    }
+    return hash_info;
+}
+
+
+std::shared_ptr<const SpectralHashInfo> OcvDnnClassifier::SpectralHashCache::load(const std::string &file_name,
+                                                                                 const std::string &expanded_path,
+                                                                                 const log4cxx::LoggerPtr &logger) {
+    try {
+        cv::FileStorage sp_params(expanded_path, cv::FileStorage::READ);
+        if (!sp_params.isOpened()) {
+            LOG4CXX_WARN(logger, "Failed to open spectral hash file named \"" << expanded_path << "\"");
+            return nullptr;
+        }
+        if (sp_params["layer_name"].empty()) {
+            LOG4CXX_WARN(logger, "The \"layer_name\" field in file \"" << expanded_path << "\" is missing.");
+            return nullptr;
+        }
+
+        auto hash_info = std::make_shared<SpectralHashInfo>();
+        sp_params["layer_name"] >> hash_info->layer_name;
+        LOG4CXX_DEBUG(logger, "layer_name = " << hash_info->layer_name);
+        if (!parseAndValidateHashInfo(expanded_path, sp_params, *hash_info, logger)) {
+            return nullptr;
+        }
+        return hash_info;
+    }
+    catch (const cv::Exception &err) {
+        LOG4CXX_WARN(logger, "Exception caught when processing spectral hash file named \""
+                     << file_name << "\": " << err.what());
+        return nullptr;
+    }
+}
+
+
+void OcvDnnClassifier::SpectralHashCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+
+
+std::vector<OcvDnnClassifier::SpectralHashIndex::Neighbor> OcvDnnClassifier::SpectralHashIndex::findNeighborsAndAdd(
+          const std::string &index_file_path, const std::string &hash_space, int nbits,
+          const std::vector<uint64_t> &hash, const std::string &id, int max_neighbors, int max_distance) {
+    std::shared_ptr<IndexFile> index_file;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<IndexFile> &index_file_ref = index_files_[index_file_path];
+        if (!index_file_ref) {
+            index_file_ref = std::make_shared<IndexFile>();
+        }
+        index_file = index_file_ref;
+    }
+
+    std::vector<Neighbor> neighbors;
+    bool already_added = false;
+    {
+        std::lock_guard<std::mutex> lock(index_file->mutex);
+        readNewEntries(index_file_path, *index_file);
+
+        auto hash_space_iter = index_file->hash_spaces.find({ hash_space, nbits });
+        if (hash_space_iter != index_file->hash_spaces.end()) {
+            const HashSpace &space = hash_space_iter->second;
+            already_added = space.id_set.count(id) > 0;
+
+            // (distance, entry index)
+            std::vector<std::pair<int, size_t>> candidates;
+            for (size_t entry : findCandidates(space, hash, max_distance)) {
+                const uint64_t *entry_words = &space.words[entry * space.words_per_hash];
+                int distance = 0;
+                for (int w = 0; w < space.words_per_hash; w++) {
+                    distance += std::bitset<64>(entry_words[w] ^ hash[w]).count();
+                }
+                if ((max_distance < 0 || distance <= max_distance) && space.ids[entry] != id) {
+                    candidates.emplace_back(distance, entry);
+                }
+            }
+
+            size_t num_neighbors = std::min(candidates.size(), static_cast<size_t>(std::max(max_neighbors, 0)));
+            std::partial_sort(candidates.begin(), candidates.begin() + num_neighbors, candidates.end());
+            for (size_t i = 0; i < num_neighbors; i++) {
+                neighbors.push_back({ space.ids[candidates[i].second], candidates[i].first });
+            }
+        }
+    }
+
+    if (!already_added) {
+        std::stringstream line;
+        line << hash_space << '\t' << nbits << '\t' << std::hex << std::setfill('0');
+        for (uint64_t word : hash) {
+            line << std::setw(16) << word;
+        }
+        line << '\t' << id << '\n';
+
+        // The new entry is read back from the file by the next search, so the search lock is not needed here.
+        std::lock_guard<std::mutex> lock(index_file->out_mutex);
+        if (!index_file->out.is_open()) {
+            index_file->out.open(index_file_path, std::ios::app);
+        }
+        // Written with a single call so that lines from other component processes are not interleaved.
+        index_file->out << line.str() << std::flush;
+        if (!index_file->out) {
+            index_file->out.close();
+            index_file->out.clear();
+            throw MPFDetectionException(MPF_FILE_WRITE_ERROR,
+                                        "Failed to write to the spectral hash index file \""
+                                        + index_file_path + "\".");
+        }
+    }
+    return neighbors;
+}
+
+
+namespace {
+    uint16_t getHashChunk(const uint64_t *hash_words, int chunk) {
+        return static_cast<uint16_t>(hash_words[chunk / 4] >> (16 * (chunk % 4)));
+    }
+
+
+    // Calls visit with every value that differs from value in at most radius of the bits in
+    // [first_bit, num_bits), including value itself. Each value is visited once.
+    template <typename Visitor>
+    void visitNearbyChunks(uint16_t value, int first_bit, int num_bits, int radius, Visitor &visit) {
+        visit(value);
+        if (radius == 0) {
+            return;
+        }
+        for (int bit = first_bit; bit < num_bits; bit++) {
+            visitNearbyChunks(static_cast<uint16_t>(value ^ (1u << bit)), bit + 1, num_bits, radius - 1, visit);
+        }
+    }
+}
+
+
+void OcvDnnClassifier::SpectralHashIndex::addEntry(HashSpace &space, const uint64_t *hash_words,
+                                                   const std::string &id) {
+    size_t entry = space.ids.size();
+    space.words.insert(space.words.end(), hash_words, hash_words + space.words_per_hash);
+    space.ids.push_back(id);
+    space.id_set.insert(id);
+    for (int chunk = 0; chunk < space.chunk_tables.size(); chunk++) {
+        space.chunk_tables[chunk][getHashChunk(hash_words, chunk)].push_back(entry);
+    }
+}
+
+
+std::vector<size_t> OcvDnnClassifier::SpectralHashIndex::findCandidates(const HashSpace &space,
+                                                                        const std::vector<uint64_t> &hash,
+                                                                        int max_distance) {
+    // Visiting every bucket within 3 or more bits of a 16-bit chunk takes hundreds of lookups per chunk, which is
+    // no faster than comparing every entry, so larger or unlimited distances fall back to a linear scan.
+    int num_chunks = space.chunk_tables.size();
+    int chunk_radius = max_distance / num_chunks;
+    std::vector<size_t> candidates;
+    if (max_distance < 0 || chunk_radius > 2) {
+        candidates.resize(space.ids.size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+        return candidates;
+    }
+
+    for (int chunk = 0; chunk < num_chunks; chunk++) {
+        const auto &table = space.chunk_tables[chunk];
+        auto add_bucket = [&](uint16_t value) {
+            auto bucket_iter = table.find(value);
+            if (bucket_iter != table.end()) {
+                candidates.insert(candidates.end(), bucket_iter->second.begin(), bucket_iter->second.end());
+            }
+        };
+        int chunk_bits = std::min(16, space.nbits - 16 * chunk);
+        visitNearbyChunks(getHashChunk(hash.data(), chunk), 0, chunk_bits, chunk_radius, add_bucket);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    return candidates;
+}
+
+
+void OcvDnnClassifier::SpectralHashIndex::readNewEntries(const std::string &index_file_path,
+                                                        IndexFile &index_file) {
+    struct stat file_stat;
+    if (stat(index_file_path.c_str(), &file_stat) != 0) {
+        return;
+    }
+    if (file_stat.st_size < index_file.loaded_size) {
+        // The file was replaced or truncated.
+        index_file.loaded_size = 0;
+        index_file.hash_spaces.clear();
+    }
+    if (file_stat.st_size == index_file.loaded_size) {
+        return;
+    }
+
+    std::ifstream in(index_file_path);
+    if (!in) {
+        return;
+    }
+    in.seekg(index_file.loaded_size);
+
+    std::string line;
+    std::vector<uint64_t> hash_words;
+    // Only complete lines are parsed, since another process may be in the middle of appending a line.
+    while (std::getline(in, line) && !in.eof()) {
+        index_file.loaded_size += line.size() + 1;
+
+        std::vector<std::string> fields;
+        boost::split(fields, line, boost::is_any_of("\t"));
+        if (fields.size() != 4) {
+            continue;
+        }
+        int nbits;
+        try {
+            nbits = std::stoi(fields[1]);
+        }
+        catch (const std::exception &) {
+            continue;
+        }
+        int words_per_hash = (nbits + 63) / 64;
+        if (nbits <= 0 || fields[2].size() != words_per_hash * 16) {
+            continue;
+        }
+
+        HashSpace &space = index_file.hash_spaces[{ fields[0], nbits }];
+        space.nbits = nbits;
+        space.words_per_hash = words_per_hash;
+        space.chunk_tables.resize((nbits + 15) / 16);
+        hash_words.clear();
+        for (int w = 0; w < words_per_hash; w++) {
+            hash_words.push_back(std::strtoull(fields[2].substr(w * 16, 16).c_str(), nullptr, 16));
+        }
+        addEntry(space, hash_words.data(), fields[3]);
+    }
+}
+
+
+void OcvDnnClassifier::SpectralHashIndex::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_files_.clear();
+}
+
+
+
+std::pair<int, int> OcvDnnClassifier::BackendBenchmarkCache::getFastestBackend(const ModelSettings &settings,
+                                                                              const cv::Size &input_size,
+                                                                              const std::string &input_name,
+                                                                              const std::string &output_layer,
+                                                                              const std::string &cache_file_path,
+                                                                              const log4cxx::LoggerPtr &logger) {
+    // The OpenCV version is part of the key because a different build of OpenCV may support different backends.
+    std::string key = std::string(CV_VERSION) + '|' + settings.model_binary_file + '|' + settings.model_config_file
+                      + '|' + std::to_string(input_size.width) + 'x' + std::to_string(input_size.height)
+                      + '|' + input_name + '|' + output_layer;
+    std::string mod_time = std::to_string(std::max(getModificationTime(settings.model_binary_file),
+                                                   getModificationTime(settings.model_config_file)));
+
+    // The lock is held while the benchmark runs so that concurrent jobs do not compete for the same hardware
+    // and skew the results.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!cache_file_path.empty() && cache_file_path != loaded_cache_file_path_) {
+        loadCacheFile(cache_file_path, logger);
+    }
+
+    auto entry_iter = entries_.find(key);
+    if (entry_iter != entries_.end() && entry_iter->second.mod_time == mod_time) {
+        return { entry_iter->second.backend, entry_iter->second.target };
+    }
+
+    std::pair<int, int> fastest = runBenchmark(settings, input_size, input_name, output_layer, logger);
+    entries_[key] = { mod_time, fastest.first, fastest.second };
+    if (!cache_file_path.empty()) {
+        // Pick up results that other processes saved while the benchmark was running.
+        loadCacheFile(cache_file_path, logger);
+        saveCacheFile(cache_file_path, logger);
+    }
+    return fastest;
+}
+
+
+std::pair<int, int> OcvDnnClassifier::BackendBenchmarkCache::runBenchmark(const ModelSettings &settings,
+                                                                         const cv::Size &input_size,
+                                                                         const std::string &input_name,
+                                                                         const std::string &output_layer,
+                                                                         const log4cxx::LoggerPtr &logger) {
+    using namespace cv::dnn;
+    std::vector<std::pair<int, int>> candidates {
+            { DNN_BACKEND_OPENCV, DNN_TARGET_CPU },
+            { DNN_BACKEND_INFERENCE_ENGINE, DNN_TARGET_CPU },
+            { DNN_BACKEND_HALIDE, DNN_TARGET_CPU },
+            { DNN_BACKEND_INFERENCE_ENGINE, DNN_TARGET_MYRIAD },
+            { DNN_BACKEND_VKCOM, DNN_TARGET_VULKAN }
+    };
+    // When OpenCL is not available, OpenCV silently falls back to the CPU, so those combinations are skipped
+    // rather than being measured a second time.
+    if (cv::ocl::haveOpenCL()) {
+        candidates.insert(candidates.end(), {
+                { DNN_BACKEND_OPENCV, DNN_TARGET_OPENCL },
+                { DNN_BACKEND_OPENCV, DNN_TARGET_OPENCL_FP16 },
+                { DNN_BACKEND_INFERENCE_ENGINE, DNN_TARGET_OPENCL },
+                { DNN_BACKEND_INFERENCE_ENGINE, DNN_TARGET_OPENCL_FP16 },
+                { DNN_BACKEND_HALIDE, DNN_TARGET_OPENCL }
+        });
+    }
+
+    LOG4CXX_INFO(logger, "Running DNN backend benchmark for model \"" << settings.model_binary_file
+                         << "\" with an input size of " << input_size << ".");
+
+    cv::Mat image(input_size, CV_8UC3);
+    cv::randu(image, 0, 256);
+    cv::Mat input_blob = blobFromImage(image);
+
+    Net net = readNet(settings.model_binary_file, settings.model_config_file);
+    if (net.empty()) {
+        throw MPFDetectionException(
+                MPF_DETECTION_NOT_INITIALIZED,
+                "Can't load the network specified by the model_config (" + settings.model_config_file
+                + ") and model_binary (" + settings.model_binary_file + ").");
+    }
+
+    // Reduced precision targets are only used when their output is close to the full precision output.
+    const double max_output_difference = 0.01;
+    const int num_timed_runs = 5;
+
+    std::pair<int, int> fastest { DNN_BACKEND_DEFAULT, DNN_TARGET_CPU };
+    double fastest_time_ms = std::numeric_limits<double>::max();
+    cv::Mat reference_output;
+    for (const auto &candidate : candidates) {
+        std::string candidate_name = getDnnEnumName(DNN_BACKEND_NAMES, candidate.first) + '/'
+                                     + getDnnEnumName(DNN_TARGET_NAMES, candidate.second);
+        try {
+            net.setPreferableBackend(candidate.first);
+            net.setPreferableTarget(candidate.second);
+
+            // The first forward pass initializes the backend, so it is not timed.
+            net.setInput(input_blob, input_name);
+            cv::Mat output = net.forward(output_layer).clone();
+            if (reference_output.empty()) {
+                reference_output = output;
+            }
+            else if (output.size != reference_output.size
+                     || cv::norm(output, reference_output, cv::NORM_INF) > max_output_difference) {
+                LOG4CXX_INFO(logger, "Not using " << candidate_name
+                                     << " because its output differs from the reference output.");
+                continue;
+            }
+
+            double min_time_ms = std::numeric_limits<double>::max();
+            for (int i = 0; i < num_timed_runs; i++) {
+                cv::TickMeter timer;
+                timer.start();
+                net.setInput(input_blob, input_name);
+                net.forward(output_layer);
+                timer.stop();
+                min_time_ms = std::min(min_time_ms, timer.getTimeMilli());
+            }
+            LOG4CXX_INFO(logger, candidate_name << " took " << min_time_ms << " ms per forward pass.");
+
+            if (min_time_ms < fastest_time_ms) {
+                fastest_time_ms = min_time_ms;
+                fastest = candidate;
+            }
+        }
+        catch (const cv::Exception &ex) {
+            LOG4CXX_DEBUG(logger, candidate_name << " is not available: " << ex.what());
+        }
+    }
+
+    if (reference_output.empty()) {
+        LOG4CXX_WARN(logger, "None of the DNN backends could run the model. Using the default backend.");
+    }
+    else {
+        LOG4CXX_INFO(logger, "Selected " << getDnnEnumName(DNN_BACKEND_NAMES, fastest.first) << '/'
+                             << getDnnEnumName(DNN_TARGET_NAMES, fastest.second)
+                             << " as the fastest DNN backend and target.");
+    }
+    return fastest;
+}
+
+
+void OcvDnnClassifier::BackendBenchmarkCache::loadCacheFile(const std::string &cache_file_path,
+                                                            const log4cxx::LoggerPtr &logger) {
+    loaded_cache_file_path_ = cache_file_path;
+    if (getModificationTime(cache_file_path) == 0) {
+        return;
+    }
+
+    try {
+        cv::FileStorage cache_file(cache_file_path, cv::FileStorage::READ);
+        if (!cache_file.isOpened()) {
+            LOG4CXX_WARN(logger, "Failed to open the DNN backend benchmark file: " << cache_file_path);
+            return;
+        }
+
+        cv::FileNode benchmarks = cache_file["benchmarks"];
+        for (cv::FileNodeIterator iter = benchmarks.begin(); iter != benchmarks.end(); ++iter) {
+            cv::FileNode benchmark = *iter;
+            cv::String key;
+            cv::String mod_time;
+            cv::String backend;
+            cv::String target;
+            benchmark["key"] >> key;
+            benchmark["mod_time"] >> mod_time;
+            benchmark["backend"] >> backend;
+            benchmark["target"] >> target;
+            // Entries loaded earlier in this process take precedence.
+            entries_.emplace(key, Entry { mod_time,
+                                          getDnnEnumValue(DNN_BACKEND_NAMES, "DNN_BACKEND", backend),
+                                          getDnnEnumValue(DNN_TARGET_NAMES, "DNN_TARGET", target) });
+        }
+    }
+    catch (const std::exception &ex) {
+        LOG4CXX_WARN(logger, "Failed to read the DNN backend benchmark file \"" << cache_file_path
+                             << "\" due to: " << ex.what());
+    }
+}
+
+
+void OcvDnnClassifier::BackendBenchmarkCache::saveCacheFile(const std::string &cache_file_path,
+                                                            const log4cxx::LoggerPtr &logger) const {
+    // The results are written to a temporary file that is then renamed, so that other processes never see a
+    // partially written file.
+    std::string temp_file_path = cache_file_path + ".tmp" + std::to_string(getpid());
+    try {
+        cv::FileStorage cache_file(temp_file_path, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_JSON);
+        if (!cache_file.isOpened()) {
+            LOG4CXX_WARN(logger, "Failed to create the DNN backend benchmark file: " << temp_file_path);
+            return;
+        }
+        cache_file << "benchmarks" << "[";
+        for (const auto &entry_pair : entries_) {
+            const Entry &entry = entry_pair.second;
+            cache_file << "{"
+                       << "key" << entry_pair.first
+                       << "mod_time" << entry.mod_time
+                       << "backend" << getDnnEnumName(DNN_BACKEND_NAMES, entry.backend)
+                       << "target" << getDnnEnumName(DNN_TARGET_NAMES, entry.target)
+                       << "}";
+        }
+        cache_file << "]";
+        cache_file.release();
+    }
+    catch (const cv::Exception &ex) {
+        LOG4CXX_WARN(logger, "Failed to write the DNN backend benchmark file \"" << temp_file_path
+                             << "\" due to: " << ex.what());
+        std::remove(temp_file_path.c_str());
+        return;
+    }
+
+    if (std::rename(temp_file_path.c_str(), cache_file_path.c_str()) != 0) {
+        LOG4CXX_WARN(logger, "Failed to move \"" << temp_file_path << "\" to \"" << cache_file_path << "\".");
+        std::remove(temp_file_path.c_str());
+    }
+}
+
+
+
+std::string OcvDnnClassifier::OcvDnnJobConfig::encodeActivationMatrix(const std::string &layer_name,
+                                                                      const cv::Mat &activations) {
+    if (activation_output_format == ActivationOutputFormat::JSON) {
+        // Create a JSON-formatted string to represent the activation
+        // values matrix.
+        cv::FileStorage act_store(layer_name + ".json", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+        act_store << "activation values" << activations;
+        return act_store.releaseAndGetString();
+    }
+
+    // The binary formats are prefixed with a header like "float32:1x1024x1x1:" that describes how to interpret
+    // the little-endian values that follow.
+    std::stringstream header;
+    header << (activation_output_fp16 ? "float16:" : "float32:");
+    for (int i = 0; i < activations.dims; i++) {
+        header << (i == 0 ? "" : "x") << activations.size[i];
+    }
+    header << ':';
+
+    cv::Mat values = activations.isContinuous() ? activations : activations.clone();
+    values = values.reshape(1, 1);
+    if (activation_output_fp16) {
+        cv::Mat fp16_values;
+        cv::convertFp16(values, fp16_values);
+        values = fp16_values;
+    }
+    size_t num_bytes = values.total() * values.elemSize();
+
+    if (activation_output_format == ActivationOutputFormat::BASE64) {
+        return header.str() + base64Encode(values.data, num_bytes);
+    }
+
+    if (!activation_file.is_open()) {
+        if (getModificationTime(activation_output_directory) == 0) {
+            cv::utils::fs::createDirectories(activation_output_directory);
+        }
+        std::string path_template = activation_output_directory + "/activations-XXXXXX";
+        std::vector<char> path_buffer(path_template.begin(), path_template.end());
+        path_buffer.push_back('\0');
+        int file_descriptor = mkstemp(path_buffer.data());
+        if (file_descriptor < 0) {
+            throw MPFDetectionException(
+                    MPF_FILE_WRITE_ERROR,
+                    "Failed to create an activation matrix file in \"" + activation_output_directory + "\".");
+        }
+        close(file_descriptor);
+        activation_file_path = path_buffer.data();
+        activation_file.open(activation_file_path, std::ios::binary | std::ios::trunc);
+    }
+
+    size_t offset = activation_file_size;
+    activation_file.write(reinterpret_cast<const char*>(values.data), num_bytes);
+    if (!activation_file) {
+        throw MPFDetectionException(
+                MPF_FILE_WRITE_ERROR,
+                "Failed to write the activation matrix to \"" + activation_file_path + "\".");
+    }
+    activation_file_size += num_bytes;
+    // The path is last because it may contain colons.
+    header << offset << ':' << activation_file_path;
+    return header.str();
+}
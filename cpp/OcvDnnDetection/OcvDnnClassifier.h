@@ -0,0 +1,437 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+#ifndef OPENMPF_COMPONENTS_OCVDNNCLASSIFIER_H
+#define OPENMPF_COMPONENTS_OCVDNNCLASSIFIER_H
+
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <log4cxx/logger.h>
+#include <opencv2/dnn.hpp>
+
+#include <BlockingQueue.h>
+#include <MPFDetectionObjects.h>
+#include <ModelsIniParser.h>
+
+
+// Returns 0 when the file does not exist, or when the path is empty.
+time_t getModificationTime(const std::string &path);
+
+
+struct SpectralHashInfo {
+    std::string file_name;
+    std::string model_name;
+    std::string layer_name;
+    int nbits;
+    cv::Mat mx;
+    cv::Mat mn;
+    cv::Mat modes;
+    cv::Mat pc;
+};
+
+// Runs images through a DNN classification model. Used by both the batch and streaming components, which keep a
+// single OcvDnnClassifier so that loaded networks and parsed files can be reused between jobs.
+class OcvDnnClassifier {
+
+public:
+
+    struct ModelSettings {
+        std::string model_config_file;
+        std::string model_binary_file;
+        std::string synset_file;
+    };
+
+    // Throws when the models.ini file in plugin_path can not be loaded.
+    void init(const std::string &plugin_path, const log4cxx::LoggerPtr &logger);
+
+    // Discards the networks and files that are kept between jobs, so that the next job loads them again.
+    void clearCaches();
+
+    struct OcvDnnJobConfig;
+
+    // The outputs of the network for a single frame.
+    struct NetworkOutput {
+        cv::Mat prob;
+        std::vector<std::pair<std::string, cv::Mat>> activation_layer_mats;
+        std::vector<std::pair<SpectralHashInfo, cv::Mat>> spectral_hash_mats;
+    };
+
+    // A video frame that is passed between the stages of the video processing pipeline.
+    struct QueuedFrame {
+        int frame_index;
+        cv::Mat frame;
+        // The size of the frame before it was preprocessed.
+        cv::Size original_frame_size;
+        // Only set when frame skipping is enabled.
+        cv::Mat signature;
+        // When set before the frame is preprocessed, the frame is not preprocessed or run through the network.
+        bool reuse_previous_detection;
+    };
+
+    // A nullptr in the queue indicates that the thread adding frames to the queue is done.
+    using FrameQueue = MPF::COMPONENT::BlockingQueue<std::unique_ptr<QueuedFrame>>;
+
+    // Sets the location parameter to a MPFImageLocation if a detection is found in the input frame.
+    std::unique_ptr<MPF::COMPONENT::MPFImageLocation> getDetection(OcvDnnJobConfig &config,
+                                                                   const cv::Mat &input_frame);
+
+    // Returns nullptr if the network output does not contain a detection. frame_index is -1 for images.
+    std::unique_ptr<MPF::COMPONENT::MPFImageLocation> createDetection(OcvDnnJobConfig &config,
+                                                                      const cv::Size &frame_size,
+                                                                      int frame_index,
+                                                                      NetworkOutput &network_output);
+
+    // Adds the location to the most recent track, or starts a new track when the classification changes.
+    static void defaultTracker(const std::string &classification_type, MPF::COMPONENT::MPFImageLocation &location,
+                               int frame_index, std::vector<MPF::COMPONENT::MPFVideoTrack> &tracks);
+
+    // Adds the location to the track and keeps the classification of the track's most confident detection.
+    static void addToTrack(const std::string &classification_type, MPF::COMPONENT::MPFImageLocation &location,
+                           int frame_index, MPF::COMPONENT::MPFVideoTrack &track);
+
+
+    // Resizes and crops the frame. The color values are subtracted when the input blob is created.
+    static cv::Mat preprocessFrame(const OcvDnnJobConfig &config, const cv::Mat &input_frame);
+
+    // Runs all of the preprocessed frames through the network in a single forward pass.
+    // network_outputs[i] will contain the outputs for preprocessed_frames[i].
+    static void getNetworkOutput(OcvDnnJobConfig &config,
+                                 const std::vector<cv::Mat> &preprocessed_frames,
+                                 std::vector<NetworkOutput> &network_outputs);
+
+
+private:
+    // Loading a model with cv::dnn::readNet is often more expensive than classifying a single image, so the
+    // loaded networks are kept between jobs. A cv::dnn::Net can only run one forward pass at a time, so each job
+    // checks out a network for its exclusive use and returns it when the job completes.
+    class NetCache {
+    public:
+        struct CachedNet {
+            cv::dnn::Net net;
+            std::vector<cv::String> layer_names;
+            std::shared_ptr<const std::vector<std::string>> class_names;
+        };
+
+        using NetPtr = std::unique_ptr<CachedNet, std::function<void(CachedNet*)>>;
+
+        NetPtr checkout(const ModelSettings &settings, int dnn_backend, int dnn_target,
+                        const log4cxx::LoggerPtr &logger);
+
+        void clear();
+
+    private:
+        // (model binary file, model config file, synset file, DNN backend, DNN target)
+        using Key = std::tuple<std::string, std::string, std::string, int, int>;
+
+        struct Entry {
+            // The most recent modification time of the files in the key. When a model's files are replaced,
+            // the networks loaded from the old files are discarded.
+            time_t mod_time;
+            std::vector<std::unique_ptr<CachedNet>> available_nets;
+        };
+
+        std::mutex mutex_;
+        std::map<Key, Entry> entries_;
+
+        void checkin(const Key &key, time_t mod_time, CachedNet *cached_net);
+
+        static std::vector<std::string> readClassNames(const std::string &synset_file);
+    };
+
+
+    // Caches the parsed contents of spectral hash files. An entry is reloaded when the file's modification time
+    // changes.
+    class SpectralHashCache {
+    public:
+        // Returns nullptr when the file could not be parsed.
+        std::shared_ptr<const SpectralHashInfo> get(const std::string &file_name, const std::string &expanded_path,
+                                                    const log4cxx::LoggerPtr &logger);
+
+        void clear();
+
+    private:
+        struct Entry {
+            time_t mod_time;
+            std::shared_ptr<const SpectralHashInfo> hash_info;
+        };
+
+        std::mutex mutex_;
+        std::unordered_map<std::string, Entry> entries_;
+
+        static std::shared_ptr<const SpectralHashInfo> load(const std::string &file_name,
+                                                            const std::string &expanded_path,
+                                                            const log4cxx::LoggerPtr &logger);
+
+        static bool parseAndValidateHashInfo(const std::string &file_name, cv::FileStorage &sp_params,
+                                             SpectralHashInfo &hash_info, const log4cxx::LoggerPtr &logger);
+    };
+
+
+    // Finds the nearest previously seen spectral hashes by Hamming distance, using an index file shared by jobs.
+    class SpectralHashIndex {
+    public:
+        struct Neighbor {
+            std::string id;
+            int distance;
+        };
+
+        // Returns up to max_neighbors of the hashes in the index file that are within max_distance bits of the
+        // given hash, closest first, and then appends the given hash to the index file. Hashes are only compared to
+        // hashes with the same hash_space and number of bits.
+        std::vector<Neighbor> findNeighborsAndAdd(const std::string &index_file_path, const std::string &hash_space,
+                                                  int nbits, const std::vector<uint64_t> &hash,
+                                                  const std::string &id, int max_neighbors, int max_distance);
+
+        void clear();
+
+    private:
+        struct HashSpace {
+            int nbits;
+            int words_per_hash;
+            // The hashes are stored contiguously, words_per_hash words each, so that they can be scanned quickly.
+            std::vector<uint64_t> words;
+            std::vector<std::string> ids;
+            std::unordered_set<std::string> id_set;
+            // Multi-index hashing: chunk_tables[c] maps the value of bits [16c, 16c + 16) of a hash to the indices of
+            // the entries with that value. Two hashes that differ in d bits have a chunk that differs in at most
+            // d / (number of chunks) bits, so only the entries in nearby buckets need to be compared.
+            std::vector<std::unordered_map<uint16_t, std::vector<size_t>>> chunk_tables;
+        };
+
+        struct IndexFile {
+            // Guards loaded_size and hash_spaces.
+            std::mutex mutex;
+            // The number of bytes of the file that have been parsed. The file may also be appended to by other
+            // component processes, so new entries are read from the file rather than added directly.
+            std::streamoff loaded_size = 0;
+            // Keyed on (hash space, number of bits).
+            std::map<std::pair<std::string, int>, HashSpace> hash_spaces;
+
+            // Guards out, which stays open for appending so that the file is not reopened for every hash.
+            std::mutex out_mutex;
+            std::ofstream out;
+        };
+
+        // Only guards index_files_. Each index file is searched and appended to under its own locks.
+        std::mutex mutex_;
+        std::unordered_map<std::string, std::shared_ptr<IndexFile>> index_files_;
+
+        static void addEntry(HashSpace &space, const uint64_t *hash_words, const std::string &id);
+
+        // Returns the indices of the entries that may be within max_distance bits of the hash, in increasing order.
+        static std::vector<size_t> findCandidates(const HashSpace &space, const std::vector<uint64_t> &hash,
+                                                  int max_distance);
+
+        static void readNewEntries(const std::string &index_file_path, IndexFile &index_file);
+    };
+
+
+    // Determines which DNN backend and target combination runs a model the fastest on this machine. The results
+    // are saved to a file so that the benchmark only needs to run once per model.
+    class BackendBenchmarkCache {
+    public:
+        // Returns the (backend, target) pair that should be passed to cv::dnn::Net::setPreferableBackend and
+        // cv::dnn::Net::setPreferableTarget.
+        std::pair<int, int> getFastestBackend(const ModelSettings &settings, const cv::Size &input_size,
+                                              const std::string &input_name, const std::string &output_layer,
+                                              const std::string &cache_file_path,
+                                              const log4cxx::LoggerPtr &logger);
+
+    private:
+        struct Entry {
+            std::string mod_time;
+            int backend;
+            int target;
+        };
+
+        std::mutex mutex_;
+        std::map<std::string, Entry> entries_;
+        std::string loaded_cache_file_path_;
+
+        void loadCacheFile(const std::string &cache_file_path, const log4cxx::LoggerPtr &logger);
+
+        void saveCacheFile(const std::string &cache_file_path, const log4cxx::LoggerPtr &logger) const;
+
+        static std::pair<int, int> runBenchmark(const ModelSettings &settings, const cv::Size &input_size,
+                                                const std::string &input_name, const std::string &output_layer,
+                                                const log4cxx::LoggerPtr &logger);
+    };
+
+
+    log4cxx::LoggerPtr logger_;
+
+    MPF::COMPONENT::ModelsIniParser<ModelSettings> models_parser_;
+
+    NetCache net_cache_;
+
+    SpectralHashCache spectral_hash_cache_;
+
+    SpectralHashIndex spectral_hash_index_;
+
+    BackendBenchmarkCache backend_benchmark_cache_;
+
+    void getTopNClasses(const cv::Mat &prob_blob, int num_classes, double threshold,
+                        std::vector< std::pair<int,float> > &classes) const;
+
+
+
+    static void addActivationLayerInfo(
+            OcvDnnJobConfig &config,
+            const std::vector<std::pair<std::string, cv::Mat>> &activation_layer_mats,
+            MPF::COMPONENT::Properties &detection_properties);
+
+
+    // frame_index is -1 for images.
+    void addSpectralHashInfo(OcvDnnJobConfig &config,
+                             const std::vector<std::pair<SpectralHashInfo, cv::Mat>> &spectral_hash_mats,
+                             int frame_index,
+                             MPF::COMPONENT::Properties &detection_properties);
+
+
+    // Computes the spectral hash for the activation values in a given
+    // layer. Bit i of the hash is stored in bit (i % 64) of word (i / 64).
+    std::vector<uint64_t> computeSpectralHash(const cv::Mat &activations,
+                                              const SpectralHashInfo &hash_info) const;
+
+    // Returns the spectral hash as a sequence of 1's and 0's.
+    static std::string formatSpectralHash(const std::vector<uint64_t> &hash, int nbits);
+
+
+public:
+    // struct to hold configuration options and data structures that change every job.
+    struct OcvDnnJobConfig {
+    public:
+        // Keeps the network checked out of the NetCache until the job completes.
+        NetCache::NetPtr cached_net;
+        cv::dnn::Net net;
+        std::shared_ptr<const std::vector<std::string>> class_names;
+
+        cv::Size resize_size;
+        cv::Size crop_size;
+        cv::Scalar subtract_colors;
+
+
+        // In order to get all the layers we need in one pass through the network, we need to add all the layer
+        // names to a single collection. After getting the output layers we need to know whether it was requested
+        // in order to get the classification, to get the activation layers, or to compute the spectral hash.
+        // In order to keep track of which layer was retrieved for which purpose output_layers will contain
+        // the layer names in a specific order.
+        // The first element is the name of the classification layer.
+        // The next region will contain the activation layer names.
+        // The final region will contain the names of the layers for which we need to compute the spectral hash.
+        std::vector<cv::String> output_layers;
+
+        std::string model_output_layer;
+        std::string model_input_name;
+
+        std::vector<std::string> requested_activation_layer_names;
+        std::vector<std::string> bad_activation_layer_names;
+
+        std::vector<SpectralHashInfo> spectral_hash_info;
+        std::vector<std::string> bad_hash_file_names;
+
+        // When not empty, each spectral hash is reported along with the most similar hashes from previous
+        // detections, and then added to this file.
+        std::string spectral_hash_index_file;
+        int spectral_hash_neighbor_count;
+        int spectral_hash_max_neighbor_distance;
+        // Used to identify the detections added to the spectral hash index.
+        std::string media_path;
+
+        int number_of_classifications;
+        double confidence_threshold;
+        std::string classification_type;
+
+        enum class ActivationOutputFormat { JSON, BASE64, FILE };
+        ActivationOutputFormat activation_output_format;
+        // When true, activation values are converted to 16-bit floats before they are encoded. Only used when
+        // activation_output_format is not JSON.
+        bool activation_output_fp16;
+        std::string activation_output_directory;
+
+        // Only opened when activation_output_format is FILE and the first activation matrix is written.
+        std::ofstream activation_file;
+        std::string activation_file_path;
+        size_t activation_file_size = 0;
+
+        // The maximum number of video frames passed to the network in a single forward pass.
+        int batch_size;
+
+        // The maximum number of video frames in each of the queues between the decoding, preprocessing,
+        // and inference stages.
+        int frame_queue_capacity;
+
+        int preprocessing_thread_count;
+
+        // When greater than 0, the network is not run on a video frame when the difference between the frame and
+        // the most recent frame that was run through the network is below this value. The skipped frame reuses
+        // the detection from that frame.
+        double frame_difference_threshold;
+
+        // The maximum number of consecutive frames that can be skipped because of frame_difference_threshold.
+        int max_skipped_frames;
+
+        // For feed-forward video jobs, only every feed_forward_classification_interval-th frame of the
+        // feed-forward track is run through the network, and the track is classified by majority vote.
+        int feed_forward_classification_interval;
+
+        // Loads the model named by the job properties using the classifier's caches.
+        OcvDnnJobConfig(const MPF::COMPONENT::Properties &props, OcvDnnClassifier &classifier);
+
+        // Returns the value of the detection property used to report the activation matrix.
+        std::string encodeActivationMatrix(const std::string &layer_name, const cv::Mat &activations);
+
+    private:
+        void validateLayerNames(
+                std::string requested_activation_layers,
+                const std::vector<cv::String> &net_layers,
+                const std::string &model_name,
+                const log4cxx::LoggerPtr &logger);
+
+
+        void getSpectralHashInfo(
+                std::string hash_file_list,
+                const std::vector<cv::String> &net_layers,
+                const std::string &model_name,
+                SpectralHashCache &spectral_hash_cache,
+                const log4cxx::LoggerPtr &logger);
+    };
+};
+
+
+#endif //OPENMPF_COMPONENTS_OCVDNNCLASSIFIER_H
@@ -26,20 +26,19 @@
 
 #include "OcvDnnDetection.h"
 
-#include <unistd.h>
+#include <algorithm>
 #include <fstream>
-#include <unordered_set>
+#include <future>
+#include <map>
 
-#include <opencv2/core/core.hpp>
 #include <opencv2/imgproc.hpp>
-#include <opencv2/dnn.hpp>
 
-#include <log4cxx/logmanager.h>
 #include <log4cxx/xml/domconfigurator.h>
 #include <boost/algorithm/string.hpp>
 
 #include <Utils.h>
 #include <detectionComponentUtils.h>
+#include <MPFDetectionException.h>
 #include <MPFInvalidPropertyException.h>
 #include <MPFImageReader.h>
 #include <MPFVideoCapture.h>
@@ -72,14 +71,8 @@ bool OcvDnnDetection::Init() {
 
     LOG4CXX_INFO(logger_, "Initializing OcvDnn");
 
-    // Load model info from config file
-    // A model is defined by a txt file, a bin file, and a synset
-
     try {
-        models_parser_.Init(plugin_path + "/models")
-                .RegisterOptionalPathField("model_config", &ModelSettings::model_config_file)
-                .RegisterPathField("model_binary", &ModelSettings::model_binary_file)
-                .RegisterPathField("synset_txt", &ModelSettings::synset_file);
+        classifier_.init(plugin_path, logger_);
     }
     catch (const std::exception &ex) {
         LOG4CXX_ERROR(logger_, "Failed to initialize ModelsIniParser due to: " << ex.what())
@@ -91,31 +84,84 @@ bool OcvDnnDetection::Init() {
 
 //-----------------------------------------------------------------------------
 bool OcvDnnDetection::Close() {
+    clearCaches();
     return true;
 }
 
 
-void addToTrack(const std::string &classification_type, MPFImageLocation &location, int frame_index, MPFVideoTrack &track) {
-    track.stop_frame = frame_index;
-    if (location.confidence > track.confidence) {
-        track.confidence = location.confidence;
-        track.detection_properties[classification_type] = location.detection_properties[classification_type];
-    }
-    track.frame_locations[frame_index] = std::move(location);
+void OcvDnnDetection::clearCaches() {
+    classifier_.clearCaches();
+    whitelist_cache_.clear();
 }
 
 
-void defaultTracker(const std::string &classification_type, MPFImageLocation &location, int frame_index,
-                    std::vector<MPFVideoTrack> &tracks) {
-    bool should_start_new_track = tracks.empty()
-                               || tracks.back().detection_properties[classification_type]
-                                  != location.detection_properties[classification_type];
+namespace {
+    // Returns a small grayscale thumbnail of the frame that is used to determine whether consecutive frames are
+    // similar enough that the network does not need to run on both of them.
+    cv::Mat getFrameSignature(const cv::Mat &frame) {
+        cv::Mat gray_frame;
+        cv::cvtColor(frame, gray_frame, cv::COLOR_BGR2GRAY);
+        cv::Mat signature;
+        cv::resize(gray_frame, signature, cv::Size(32, 32), 0, 0, cv::INTER_AREA);
+        return signature;
+    }
 
-    if (should_start_new_track) {
-        tracks.emplace_back(frame_index, frame_index, location.confidence,
-                            Properties{ { classification_type, location.detection_properties[classification_type] } });
+
+    // Returns the mean absolute difference between the pixels in the two signatures, scaled to [0, 1].
+    double getFrameDifference(const cv::Mat &signature1, const cv::Mat &signature2) {
+        return cv::norm(signature1, signature2, cv::NORM_L1) / (signature1.total() * 255.0);
+    }
+
+
+    // Sets the track's classification to the most common classification of its detections. Ties are broken by
+    // the highest detection confidence.
+    void setClassificationByMajorityVote(const std::string &classification_type, MPFVideoTrack &track) {
+        // classification -> (number of votes, highest confidence)
+        std::map<std::string, std::pair<int, float>> votes;
+        for (const auto &frame_location : track.frame_locations) {
+            const MPFImageLocation &location = frame_location.second;
+            auto classification_iter = location.detection_properties.find(classification_type);
+            if (classification_iter == location.detection_properties.end()) {
+                continue;
+            }
+            auto &vote = votes.emplace(classification_iter->second, std::make_pair(0, location.confidence))
+                    .first->second;
+            vote.first++;
+            vote.second = std::max(vote.second, location.confidence);
+        }
+
+        auto winner = std::max_element(votes.begin(), votes.end(), [](
+                const std::pair<const std::string, std::pair<int, float>> &a,
+                const std::pair<const std::string, std::pair<int, float>> &b) {
+            return a.second < b.second;
+        });
+        if (winner != votes.end()) {
+            track.detection_properties[classification_type] = winner->first;
+            track.confidence = winner->second.second;
+        }
+    }
+
+
+    // Returns a copy of the detection that only has its classification properties, for frames that reuse the
+    // detection without running the network. Activations and spectral hashes describe the frame that was run through
+    // the network, so they are not copied. Returns null when the detection has no classification.
+    std::unique_ptr<MPFImageLocation> copyClassification(const std::string &classification_type,
+                                                         const MPFImageLocation &location) {
+        if (location.detection_properties.count(classification_type) == 0) {
+            return nullptr;
+        }
+        std::unique_ptr<MPFImageLocation> classification(new MPFImageLocation(
+                location.x_left_upper, location.y_left_upper, location.width, location.height, location.confidence));
+        for (const std::string &name : { classification_type,
+                                         classification_type + " LIST",
+                                         classification_type + " CONFIDENCE LIST" }) {
+            auto property_iter = location.detection_properties.find(name);
+            if (property_iter != location.detection_properties.end()) {
+                classification->detection_properties.insert(*property_iter);
+            }
+        }
+        return classification;
     }
-    addToTrack(classification_type, location, frame_index, tracks.back());
 }
 
 
@@ -125,11 +171,11 @@ void feedForwardTracker(const std::string &classification_type, MPFImageLocation
         tracks.emplace_back(frame_index, frame_index, location.confidence,
                             Properties{ { classification_type, location.detection_properties[classification_type] } });
     }
-    addToTrack(classification_type, location, frame_index, tracks.back());
+    OcvDnnClassifier::addToTrack(classification_type, location, frame_index, tracks.back());
 }
 
 
-std::string getFeedForwardExcludeBehavior(const MPFJob &job, const Properties &feed_forward_props) {
+std::string OcvDnnDetection::getFeedForwardExcludeBehavior(const MPFJob &job, const Properties &feed_forward_props) {
     auto feed_forward_props_iter = feed_forward_props.find("CLASSIFICATION");
     if (feed_forward_props_iter != feed_forward_props.end()) {
         const std::string &class_name = feed_forward_props_iter->second;
@@ -147,20 +193,8 @@ std::string getFeedForwardExcludeBehavior(const MPFJob &job, const Properties &f
                         "The value, \"" + feed_forward_whitelist_file + "\", could not be expanded due to: " + error);
             }
 
-            std::ifstream whitelist_file(expanded_file_path);
-            if (!whitelist_file.good()) {
-                throw MPFDetectionException(
-                        MPF_COULD_NOT_OPEN_DATAFILE,
-                        "Failed to load feed-forward class whitelist that was supposed to be located at \""
-                        + expanded_file_path + "\".");
-            }
-
-            std::string line;
-            while (std::getline(whitelist_file, line)) {
-                Utils::trim(line);
-                if (boost::iequals(line, class_name)) {
-                    return "";
-                }
+            if (whitelist_cache_.get(expanded_file_path)->count(boost::to_lower_copy(class_name)) > 0) {
+                return "";
             }
 
             std::string feed_forward_exclude_behavior =
@@ -185,7 +219,7 @@ std::string getFeedForwardExcludeBehavior(const MPFJob &job, const Properties &f
 std::vector<MPFVideoTrack> OcvDnnDetection::GetDetections(const MPFVideoJob &job) {
     try {
         if (!job.has_feed_forward_track) {
-            return getDetections(job, defaultTracker);
+            return getDetections(job, OcvDnnClassifier::defaultTracker);
         }
 
         const Properties &feed_forward_track_props = job.feed_forward_track.detection_properties;
@@ -227,26 +261,147 @@ std::vector<MPFVideoTrack> OcvDnnDetection::GetDetections(const MPFVideoJob &job
 
 
 template<typename Tracker>
-std::vector<MPFVideoTrack> OcvDnnDetection::getDetections(const MPFVideoJob &job, Tracker tracker) const {
-    OcvDnnJobConfig config(job.job_properties, models_parser_, logger_);
+std::vector<MPFVideoTrack> OcvDnnDetection::getDetections(const MPFVideoJob &job, Tracker tracker) {
+    OcvDnnJobConfig config(job.job_properties, classifier_);
+    config.media_path = job.data_uri;
 
     MPFVideoCapture video_cap(job);
 
-    cv::Mat frame;
-    int frame_index = -1;
+    int classification_interval = job.has_feed_forward_track ? config.feed_forward_classification_interval : 1;
+
+    // Frames are decoded on one thread and preprocessed on config.preprocessing_thread_count threads. This thread
+    // only runs the network, so it does not need to wait for the next frames to be decoded and preprocessed.
+    FrameQueue decoded_frames(config.frame_queue_capacity);
+    FrameQueue preprocessed_frames(config.frame_queue_capacity);
+    std::vector<std::future<void>> worker_futures;
+
     std::vector<MPFVideoTrack> tracks;
-    while (video_cap.Read(frame)) {
-        frame_index++;
-        std::unique_ptr<MPFImageLocation> location = getDetection(config, frame);
-        if (!location) {
-            // Nothing found in current frame.
-            continue;
+    try {
+        worker_futures.push_back(std::async(std::launch::async, decodeFrames, std::ref(video_cap),
+                                            classification_interval, config.preprocessing_thread_count,
+                                            std::ref(decoded_frames), std::ref(preprocessed_frames)));
+        for (int i = 0; i < config.preprocessing_thread_count; i++) {
+            worker_futures.push_back(std::async(std::launch::async, preprocessFrames, std::cref(config),
+                                                std::ref(decoded_frames), std::ref(preprocessed_frames)));
         }
 
-        tracker(config.classification_type, *location, frame_index, tracks);
+        // When there is more than one preprocessing thread, frames may finish preprocessing out of order.
+        // They are held here until all of the preceding frames have been received.
+        std::map<int, std::unique_ptr<QueuedFrame>> out_of_order_frames;
+        int next_frame_index = 0;
+        int num_running_preprocessing_threads = config.preprocessing_thread_count;
+
+        // The frames that will be passed to the tracker after the next forward pass. This includes the frames
+        // that were skipped because they are similar to the most recent frame that was run through the network.
+        std::vector<std::unique_ptr<QueuedFrame>> pending_frames;
+        // The frames that will be run through the network in the next forward pass.
+        std::vector<cv::Mat> batch_frames;
+        batch_frames.reserve(config.batch_size);
+        std::vector<NetworkOutput> network_outputs;
+
+        // The classification from, and signature of, the most recent frame that was run through the network.
+        std::unique_ptr<MPFImageLocation> previous_location;
+        cv::Mat previous_signature;
+        int num_skipped_frames = 0;
+
+        while (num_running_preprocessing_threads > 0 || !out_of_order_frames.empty()) {
+            if (num_running_preprocessing_threads > 0) {
+                std::unique_ptr<QueuedFrame> queued_frame = preprocessed_frames.pop();
+                if (queued_frame == nullptr) {
+                    num_running_preprocessing_threads--;
+                }
+                else {
+                    int frame_index = queued_frame->frame_index;
+                    out_of_order_frames.emplace(frame_index, std::move(queued_frame));
+                }
+            }
+
+            auto frame_iter = out_of_order_frames.begin();
+            while (frame_iter != out_of_order_frames.end() && frame_iter->first == next_frame_index
+                    && batch_frames.size() < config.batch_size) {
+                QueuedFrame &queued_frame = *frame_iter->second;
+                bool can_skip = !queued_frame.signature.empty() && !previous_signature.empty()
+                                && num_skipped_frames < config.max_skipped_frames;
+                if (queued_frame.reuse_previous_detection) {
+                    // The frame was not selected by classification_interval, so it was not preprocessed.
+                }
+                else if (can_skip && getFrameDifference(queued_frame.signature, previous_signature)
+                                        < config.frame_difference_threshold) {
+                    queued_frame.reuse_previous_detection = true;
+                    queued_frame.frame.release();
+                    num_skipped_frames++;
+                }
+                else {
+                    batch_frames.push_back(queued_frame.frame);
+                    previous_signature = queued_frame.signature;
+                    num_skipped_frames = 0;
+                }
+                pending_frames.push_back(std::move(frame_iter->second));
+                frame_iter = out_of_order_frames.erase(frame_iter);
+                next_frame_index++;
+            }
+
+            if (batch_frames.size() < config.batch_size && num_running_preprocessing_threads > 0) {
+                continue;
+            }
+            if (pending_frames.empty()) {
+                break;
+            }
+
+            if (!batch_frames.empty()) {
+                OcvDnnClassifier::getNetworkOutput(config, batch_frames, network_outputs);
+            }
+
+            auto network_output_iter = network_outputs.begin();
+            for (const auto &pending_frame : pending_frames) {
+                std::unique_ptr<MPFImageLocation> location;
+                if (pending_frame->reuse_previous_detection) {
+                    if (previous_location) {
+                        location.reset(new MPFImageLocation(*previous_location));
+                        location->width = pending_frame->original_frame_size.width;
+                        location->height = pending_frame->original_frame_size.height;
+                    }
+                }
+                else {
+                    location = classifier_.createDetection(config, pending_frame->original_frame_size,
+                                                           pending_frame->frame_index, *network_output_iter++);
+                    if (config.frame_difference_threshold > 0 || classification_interval > 1) {
+                        previous_location = location ? copyClassification(config.classification_type, *location)
+                                                     : nullptr;
+                    }
+                }
+
+                if (!location) {
+                    // Nothing found in current frame.
+                    continue;
+                }
+
+                tracker(config.classification_type, *location, pending_frame->frame_index, tracks);
+            }
+            pending_frames.clear();
+            batch_frames.clear();
+        }
+    }
+    catch (...) {
+        // Make any worker threads that are still running exit.
+        decoded_frames.halt();
+        preprocessed_frames.halt();
+        // When a worker thread fails, it halts the queues, which causes a QueueHaltedException to be thrown on
+        // this thread. In that case, the worker thread's exception is re-thrown here instead.
+        for (auto &worker_future : worker_futures) {
+            worker_future.get();
+        }
+        throw;
+    }
+
+    for (auto &worker_future : worker_futures) {
+        worker_future.get();
     }
 
     for (MPFVideoTrack &track : tracks) {
+        if (classification_interval > 1) {
+            setClassificationByMajorityVote(config.classification_type, track);
+        }
         video_cap.ReverseTransform(track);
     }
 
@@ -256,6 +411,73 @@ std::vector<MPFVideoTrack> OcvDnnDetection::getDetections(const MPFVideoJob &job
 }
 
 
+void OcvDnnDetection::decodeFrames(MPFVideoCapture &video_cap, int classification_interval,
+                                   int num_preprocessing_threads,
+                                   FrameQueue &decoded_frames, FrameQueue &preprocessed_frames) {
+    try {
+        int frame_index = 0;
+        while (true) {
+            // A new cv::Mat is needed for each frame because the previous frames may still be in a queue.
+            cv::Mat frame;
+            if (!video_cap.Read(frame)) {
+                break;
+            }
+            cv::Size frame_size = frame.size();
+            bool skip_frame = frame_index % classification_interval != 0;
+            if (skip_frame) {
+                frame.release();
+            }
+            std::unique_ptr<QueuedFrame> queued_frame(
+                    new QueuedFrame{ frame_index, std::move(frame), frame_size, cv::Mat(), skip_frame });
+            decoded_frames.push(std::move(queued_frame));
+            frame_index++;
+        }
+
+        // Put a nullptr into the queue for each preprocessing thread to tell them they are done.
+        for (int i = 0; i < num_preprocessing_threads; i++) {
+            decoded_frames.emplace(nullptr);
+        }
+    }
+    catch (const QueueHaltedException&) {
+        // The inference thread requested early exit.
+    }
+    catch (...) {
+        decoded_frames.halt();
+        preprocessed_frames.halt();
+        throw; // Exception will be re-thrown when the future's get() is called.
+    }
+}
+
+
+void OcvDnnDetection::preprocessFrames(const OcvDnnJobConfig &config, FrameQueue &decoded_frames,
+                                       FrameQueue &preprocessed_frames) {
+    try {
+        while (true) {
+            std::unique_ptr<QueuedFrame> queued_frame = decoded_frames.pop();
+            if (queued_frame == nullptr) {
+                preprocessed_frames.emplace(nullptr);
+                return;
+            }
+            if (!queued_frame->reuse_previous_detection) {
+                queued_frame->frame = OcvDnnClassifier::preprocessFrame(config, queued_frame->frame);
+                if (config.frame_difference_threshold > 0) {
+                    queued_frame->signature = getFrameSignature(queued_frame->frame);
+                }
+            }
+            preprocessed_frames.push(std::move(queued_frame));
+        }
+    }
+    catch (const QueueHaltedException&) {
+        // The inference thread requested early exit.
+    }
+    catch (...) {
+        decoded_frames.halt();
+        preprocessed_frames.halt();
+        throw; // Exception will be re-thrown when the future's get() is called.
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 std::vector<MPFImageLocation> OcvDnnDetection::GetDetections(const MPFImageJob &job) {
     try {
@@ -269,7 +491,8 @@ std::vector<MPFImageLocation> OcvDnnDetection::GetDetections(const MPFImageJob &
             }
         }
 
-        OcvDnnJobConfig config(job.job_properties, models_parser_, logger_);
+        OcvDnnJobConfig config(job.job_properties, classifier_);
+        config.media_path = job.data_uri;
 
         LOG4CXX_DEBUG(logger_, "Data URI = " << job.data_uri);
 
@@ -277,7 +500,7 @@ std::vector<MPFImageLocation> OcvDnnDetection::GetDetections(const MPFImageJob &
         cv::Mat img = image_reader.GetImage();
 
         std::vector<MPFImageLocation> locations;
-        std::unique_ptr<MPFImageLocation> detection = getDetection(config, img);
+        std::unique_ptr<MPFImageLocation> detection = classifier_.getDetection(config, img);
         if (detection) {
             locations.push_back(std::move(*detection));
         }
@@ -307,504 +530,45 @@ std::vector<MPFImageLocation> OcvDnnDetection::GetDetections(const MPFImageJob &
 }
 
 
-//-----------------------------------------------------------------------------
-void OcvDnnDetection::getTopNClasses(cv::Mat &prob_blob,
-                                    int num_classes, double threshold,
-                                    std::vector< std::pair<int, float> > &classes) const {
-
-    LOG4CXX_DEBUG(logger_, "prob blob mat rows = " << prob_blob.rows << " cols = " << prob_blob.cols);
-
-    cv::Mat prob_mat = prob_blob.reshape(1, 1); // reshape the blob to 1x1000 matrix (googlenet)
-
-    LOG4CXX_DEBUG(logger_, "reshaped prob blob mat rows = " << prob_blob.rows << " cols = " << prob_blob.cols);
-
-    cv::Mat sort_mat;
-    cv::sortIdx(prob_mat, sort_mat, cv::SORT_EVERY_ROW + cv::SORT_DESCENDING);
-
-    for (int i = 0; i < num_classes; i++) {
-        int idx = sort_mat.at<int>(i);
-        // Keep accumulating until we go below the confidence threshold.
-        if (prob_mat.at<float>(0,idx) < threshold) break;
-        classes.push_back(std::make_pair(idx, prob_mat.at<float>(0,idx)));
-    }
-}
-
-
-
-std::unique_ptr<MPFImageLocation> OcvDnnDetection::getDetection(OcvDnnJobConfig &config,
-                                                                const cv::Mat &input_frame) const {
-
-    cv::Mat prob;
-    std::vector<std::pair<std::string, cv::Mat>> activation_layer_mats;
-    std::vector<std::pair<SpectralHashInfo, cv::Mat>> spectral_hash_mats;
-    getNetworkOutput(config, input_frame, prob, activation_layer_mats, spectral_hash_mats);
-
-    LOG4CXX_DEBUG(logger_, "output prob mat rows = " << prob.rows << " cols = " << prob.cols);
-    LOG4CXX_DEBUG(logger_, "output prob mat total: " << prob.total());
-
-    // The number of classifications requested must be greater
-    // than 0 and less than the total size of the output blob.
-    if ((config.number_of_classifications <= 0) || (config.number_of_classifications > prob.total())) {
-        throw MPFDetectionException(
-                MPF_INVALID_PROPERTY,
-                "Number of classifications requested: " +  std::to_string(config.number_of_classifications) +
-                " is invalid. It must be greater than 0, and less than the total returned by the net output layer = "
-                + std::to_string(prob.total()));
-    }
-
-    std::vector<std::pair<int, float>> class_info;
-    getTopNClasses(prob, config.number_of_classifications, config.confidence_threshold, class_info);
-
-    if (class_info.empty() && activation_layer_mats.empty() && spectral_hash_mats.empty()) {
-        return nullptr;
-    }
-
-
-    std::unique_ptr<MPFImageLocation> location(
-            new MPFImageLocation(0, 0, input_frame.cols, input_frame.rows));
-
-    if (!class_info.empty()) {
-        // Save the highest confidence classification and its corresponding confidence
-        // as the MPFImageLocation confidence.
-        LOG4CXX_DEBUG(logger_, "class id #0: " << class_info[0].first);
-        LOG4CXX_DEBUG(logger_, "confidence: " << class_info[0].second);
-        location->confidence =  class_info[0].second;
-        location->detection_properties[config.classification_type] = config.class_names.at(class_info[0].first);
-
-        // Begin accumulating the classifications in a stringstream for the classification list.
-        std::stringstream ss_ids;
-        ss_ids << config.class_names.at(class_info[0].first);
-
-        // Use another stringstream for the classification confidence list.
-        std::stringstream ss_conf;
-        ss_conf << class_info[0].second;
-
-        for (int i = 1; i < class_info.size(); i++) {
-            LOG4CXX_DEBUG(logger_, "class id #" << i << ": " << class_info[i].first);
-            LOG4CXX_DEBUG(logger_, "confidence: " << class_info[i].second);
-            ss_ids << "; " << config.class_names.at(class_info[i].first);
-            ss_conf << "; " << class_info[i].second;
-        }
-        location->detection_properties[config.classification_type + " LIST"] = ss_ids.str();
-        location->detection_properties[config.classification_type + " CONFIDENCE LIST"] = ss_conf.str();
-    }
-
-    addActivationLayerInfo(config, activation_layer_mats, location->detection_properties);
-    addSpectralHashInfo(config, spectral_hash_mats, location->detection_properties);
-
-    return location;
-}
-
-
-
-void OcvDnnDetection::addActivationLayerInfo(const OcvDnnDetection::OcvDnnJobConfig &config,
-                                            const std::vector<std::pair<std::string, cv::Mat>> &activation_layer_mats,
-                                            MPF::COMPONENT::Properties &detection_properties) {
-
-    for (const auto &activation_pair : activation_layer_mats) {
-        // Create a JSON-formatted string to represent the activation
-        // values matrix.
-        std::string name = activation_pair.first;
-        std::string filename = name + ".json";
-        cv::FileStorage act_store(filename, cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
-        act_store << "activation values" << activation_pair.second;
-        std::string actString = act_store.releaseAndGetString();
-        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
-        name += " ACTIVATION MATRIX";
-        detection_properties[name] = actString;
-    }
-
-    if (!config.bad_activation_layer_names.empty()) {
-        detection_properties["INVALID ACTIVATION LAYER LIST"] = boost::algorithm::join(config.bad_activation_layer_names, "; ");
-    }
-}
-
-
-
-void OcvDnnDetection::addSpectralHashInfo(OcvDnnDetection::OcvDnnJobConfig &config,
-                                          const std::vector<std::pair<SpectralHashInfo, cv::Mat>> &spectral_hash_mats,
-                                          Properties &detection_properties) const {
-
-    for (const auto& hash_info_pair : spectral_hash_mats) {
-        try {
-            detection_properties.emplace(computeSpectralHash(hash_info_pair.second, hash_info_pair.first));
-        } catch (const cv::Exception &err) {
-            LOG4CXX_ERROR(logger_, "OpenCV exception caught while calculating the spectral hash for layer \""
-                          << hash_info_pair.first.layer_name << "\" in model named \""
-                          << hash_info_pair.first.model_name << "\": " << err.what());
-            const std::string &bad_file_name = hash_info_pair.first.file_name;
-            if (std::find(config.bad_hash_file_names.begin(),
-                          config.bad_hash_file_names.end(),
-                          bad_file_name) == config.bad_hash_file_names.end()) {
-                config.bad_hash_file_names.push_back(bad_file_name);
-            }
-        }
-    }
-
-    if (!config.bad_hash_file_names.empty()) {
-        detection_properties["INVALID SPECTRAL HASH FILENAME LIST"]
-                = boost::algorithm::join(config.bad_hash_file_names, "; ");
-    }
-}
-
-
-
-std::pair<std::string, std::string> OcvDnnDetection::computeSpectralHash(const cv::Mat &activations,
-                                                                        const SpectralHashInfo &hash_info) const {
-    cv::Mat omega0;
-    cv::Mat omegas;
-    std::string bitset;
-
-    omega0 = CV_PI / (hash_info.mx - hash_info.mn);
-    omegas = cv::repeat(omega0, hash_info.modes.rows, 1);
-    omegas = omegas.mul(hash_info.modes);
-    cv::Mat x = cv::repeat( ((activations * hash_info.pc) - hash_info.mn), omegas.rows, 1).mul(omegas);
-    if (hash_info.nbits != x.rows) {
-        LOG4CXX_WARN(logger_, "Number of bits in the spectral hash for layer \"" << hash_info.layer_name
-                     << "\" in model named \"" << hash_info.model_name
-                     << "\" is not equal to the input nbits value: nbits = " << hash_info.nbits
-                     << ", spectral hash size = " << x.rows);
-    }
-
-    for(int r = 0; r < x.rows; r++){
-        int bit = 1;
-        for(int c = 0; c < x.cols; c++){
-            bit *= ((cos(x.at<float>(r, c)) > 0) ? 1 : -1);
-        }
-        if(bit > 0) {
-            bitset += "1";
-        } else {
-            bitset += "0";
+std::shared_ptr<const std::unordered_set<std::string>> OcvDnnDetection::WhitelistCache::get(
+        const std::string &expanded_path) {
+    time_t mod_time = getModificationTime(expanded_path);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto entry_iter = entries_.find(expanded_path);
+        if (entry_iter != entries_.end() && entry_iter->second.mod_time == mod_time) {
+            return entry_iter->second.class_names;
         }
     }
 
-    std::string name(hash_info.layer_name);
-    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
-    name += " SPECTRAL HASH VALUE";
-    return std::make_pair(name, bitset);
-}
-
-
-void OcvDnnDetection::getNetworkOutput(OcvDnnDetection::OcvDnnJobConfig &config,
-                                       const cv::Mat &input_frame,
-                                       cv::Mat &output_layer,
-                                       std::vector<std::pair<std::string, cv::Mat>> &activation_layer_info,
-                                       std::vector<std::pair<SpectralHashInfo, cv::Mat>> &spectral_hash_info) {
-    cv::Mat frame;
-    cv::resize(input_frame, frame, config.resize_size);
-
-    cv::Rect roi(config.crop_size, frame.size() - (config.crop_size * 2));
-    frame = frame(roi);
-
-    // convert Mat to batch of images (BGR)
-    cv::Mat input_blob = cv::dnn::blobFromImage(frame, 1.0, cv::Size(), config.subtract_colors, false); // swapRB = false
-
-    config.net.setInput(input_blob, config.model_input_name);
-
-
-    std::vector<cv::Mat> net_output;
-    config.net.forward(net_output, config.output_layers);
-    assert(net_output.size() == 1 + config.requested_activation_layer_names.size() + config.spectral_hash_info.size());
-
-    auto net_out_iter = std::make_move_iterator(net_output.begin());
-    output_layer = *net_out_iter++;
-
-    for (const auto &layer_name : config.requested_activation_layer_names) {
-        activation_layer_info.emplace_back(layer_name, *net_out_iter++);
-    }
-
-    for (const auto &hash_info : config.spectral_hash_info) {
-        spectral_hash_info.emplace_back(hash_info, *net_out_iter++);
-    }
-}
-
-
-//-----------------------------------------------------------------------------
-
-MPF_COMPONENT_CREATOR(OcvDnnDetection);
-MPF_COMPONENT_DELETER();
-
-
-OcvDnnDetection::OcvDnnJobConfig::OcvDnnJobConfig(const Properties &props,
-                                               const MPF::COMPONENT::ModelsIniParser<ModelSettings> &model_parser,
-                                               const log4cxx::LoggerPtr &logger) {
-
-    using namespace DetectionComponentUtils;
-
-    const std::string &model_name = GetProperty<std::string>(props,
-                                                             "MODEL_NAME",
-                                                             "googlenet");
-    const std::string &models_dir_path = GetProperty<std::string>(props,
-                                                                  "MODELS_DIR_PATH",
-                                                                  ".");
-    ModelSettings settings = model_parser.ParseIni(model_name,
-                                                   models_dir_path + "/OcvDnnDetection");
-
-    LOG4CXX_INFO(logger, "Get detections using model: " << model_name);
-
-    class_names = readClassNames(settings.synset_file);
-
-    // Import the model
-    // For models that do not support or require a config file, ModelsIniParser
-    // will assign the empty string as default to settings.model_config_file.
-    // OpenCV DNN's readNet ignores the config file when it is passed an empty
-    // string path, so we need not check whether the file exists.
-    net = cv::dnn::readNet(settings.model_binary_file, settings.model_config_file);
-    if (net.empty()) {
-        throw MPFDetectionException(
-                MPF_DETECTION_NOT_INITIALIZED,
-                "Can't load the network specified by the model_config (" + settings.model_binary_file
-                + ") and model_binary (" + settings.model_binary_file + ").");
-    }
-
-    LOG4CXX_DEBUG(logger, "Created neural network");
-
-    resize_size = cv::Size(GetProperty(props, "RESIZE_WIDTH", 224), GetProperty(props, "RESIZE_HEIGHT", 224));
-
-    crop_size = cv::Size(GetProperty(props, "LEFT_AND_RIGHT_CROP", 0), GetProperty(props, "TOP_AND_BOTTOM_CROP", 0));
-
-    subtract_colors = cv::Scalar(GetProperty(props, "SUBTRACT_BLUE_VALUE", 0.0),
-                                 GetProperty(props, "SUBTRACT_GREEN_VALUE", 0.0),
-                                 GetProperty(props, "SUBTRACT_RED_VALUE", 0.0));
-
-
-    const std::vector<cv::String> &net_layer_names = net.getLayerNames();
-
-    model_input_name = GetProperty(props, "MODEL_INPUT_NAME", std::string("data"));
-    model_output_layer = GetProperty(props, "MODEL_OUTPUT_LAYER", std::string("prob"));
-    bool output_layer_missing = std::find(net_layer_names.begin(), net_layer_names.end(), model_output_layer)
-                                    == net_layer_names.end();
-    if (output_layer_missing) {
-        throw MPFDetectionException(MPF_INVALID_PROPERTY,
-                                "The requested output layer: " + model_output_layer + " does not exist");
-    }
-
-
-    validateLayerNames(
-            GetProperty(props, "ACTIVATION_LAYER_LIST", std::string()),
-            net_layer_names, model_name, logger);
-
-    getSpectralHashInfo(
-            GetProperty(props, "SPECTRAL_HASH_FILE_LIST", std::string()),
-            net_layer_names, model_name, logger);
-
-
-    output_layers.reserve(1 + requested_activation_layer_names.size() + spectral_hash_info.size());
-    output_layers.emplace_back(model_output_layer);
-    output_layers.insert(output_layers.end(),
-                         requested_activation_layer_names.begin(), requested_activation_layer_names.end());
-    for (const auto &hash_info : spectral_hash_info) {
-        output_layers.emplace_back(hash_info.layer_name);
-    }
-
-    number_of_classifications = GetProperty(props, "NUMBER_OF_CLASSIFICATIONS", 1);
-    confidence_threshold = GetProperty(props, "CONFIDENCE_THRESHOLD", 0.0);
-    classification_type = GetProperty(props, "CLASSIFICATION_TYPE", "CLASSIFICATION");
-}
-
-
-
-std::vector<std::string> OcvDnnDetection::OcvDnnJobConfig::readClassNames(const std::string &synset_file) {
-    std::ifstream fp(synset_file);
-    if (!fp.is_open()) {
+    std::ifstream whitelist_file(expanded_path);
+    if (!whitelist_file.good()) {
         throw MPFDetectionException(
                 MPF_COULD_NOT_OPEN_DATAFILE,
-                "Failed to open the synset file that was expected to be located at: " + synset_file);
+                "Failed to load feed-forward class whitelist that was supposed to be located at \""
+                + expanded_path + "\".");
     }
 
-    std::vector<std::string> class_names;
-    std::string name;
-    while (std::getline(fp, name))
-    {
-        if (name.length()) {
-            class_names.push_back(name.substr(name.find(' ') + 1));
-        }
+    auto class_names = std::make_shared<std::unordered_set<std::string>>();
+    std::string line;
+    while (std::getline(whitelist_file, line)) {
+        Utils::trim(line);
+        class_names->insert(boost::to_lower_copy(line));
     }
-    fp.close();
 
-    if (class_names.empty()) {
-        throw MPFDetectionException(MPF_DETECTION_FAILED, "No network class labels found.");
-    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[expanded_path] = { mod_time, class_names };
     return class_names;
 }
 
 
-
-void OcvDnnDetection::OcvDnnJobConfig::validateLayerNames(std::string requested_activation_layers,
-                                                        const std::vector<cv::String> &net_layers,
-                                                        const std::string &model_name,
-                                                        const log4cxx::LoggerPtr &logger) {
-    // Get the layers in the net and check that each layer
-    // requested is actually part of the net. If it is, add it to the
-    // vector of layer names for which we need the layer output. If
-    // not, remember the name so that we can indicate in the output
-    // that it was not found.
-
-    if (!requested_activation_layers.empty()) {
-        boost::trim(requested_activation_layers);
-        std::vector<std::string> names;
-        boost::split(names, requested_activation_layers,
-                     boost::is_any_of(" ;"),
-                     boost::token_compress_on);
-        for (const std::string &name : names) {
-            if (!name.empty()) {
-                if (std::find(net_layers.begin(), net_layers.end(), name) != net_layers.end()) {
-                    requested_activation_layer_names.push_back(name);
-                }
-                else {
-                    LOG4CXX_WARN(logger, "Layer named \"" << name << "\" was not found in model named \""
-                                                          << model_name << "\"");
-                    bad_activation_layer_names.push_back(name);
-                }
-            }
-        }
-    }
+void OcvDnnDetection::WhitelistCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
 }
 
 
-bool OcvDnnDetection::OcvDnnJobConfig::parseAndValidateHashInfo(const std::string &file_name,
-                                                              cv::FileStorage &sp_params,
-                                                              SpectralHashInfo &hash_info,
-                                                              const log4cxx::LoggerPtr &logger) {
-    bool is_good_file_name = true;
-
-    if (sp_params["nbits"].empty()) {
-        LOG4CXX_WARN(logger, "The \"nbits\" field in file \"" << file_name << "\" is missing.");
-        is_good_file_name = false;
-    }
-    else {
-        sp_params["nbits"] >> hash_info.nbits;
-        if (hash_info.nbits <= 0) {
-            LOG4CXX_WARN(logger, "The \"nbits\" value in file \"" << file_name << "\" is less than or equal to zero.");
-            is_good_file_name = false;
-        }
-    }
-
-    if (sp_params["mx"].empty()) {
-        LOG4CXX_WARN(logger, "The \"mx\" field in file \"" << file_name << "\" is missing.");
-        is_good_file_name = false;
-    }
-    else {
-        sp_params["mx"] >> hash_info.mx;
-        if (hash_info.mx.empty()) {
-            LOG4CXX_WARN(logger, "The \"mx\" matrix in file \"" << file_name << "\" is empty.");
-            is_good_file_name = false;
-        }
-    }
-    if (sp_params["mn"].empty()) {
-        LOG4CXX_WARN(logger, "The \"mn\" field in file \"" << file_name << "\" is missing.");
-        is_good_file_name = false;
-    }
-    else {
-        sp_params["mn"] >> hash_info.mn;
-        if (hash_info.mn.empty()) {
-            LOG4CXX_WARN(logger, "The \"mn\" matrix in file \"" << file_name << "\" is empty.");
-            is_good_file_name = false;
-        }
-    }
-    if (sp_params["modes"].empty()) {
-        LOG4CXX_WARN(logger, "The \"modes\" field in file \"" << file_name << "\" is missing.");
-        is_good_file_name = false;
-    }
-    else {
-        sp_params["modes"] >> hash_info.modes;
-        if (hash_info.modes.empty()) {
-            LOG4CXX_WARN(logger, "The \"modes\" matrix in file \"" << file_name << "\" is empty.");
-            is_good_file_name = false;
-        }
-    }
-    if(sp_params["pc"].empty()) {
-        LOG4CXX_WARN(logger, "The \"pc\" field in file \"" << file_name << "\" is missing.");
-        is_good_file_name = false;
-    }
-    else {
-        sp_params["pc"] >> hash_info.pc;
-        if (hash_info.pc.empty()) {
-            LOG4CXX_WARN(logger, "The \"pc\" matrix in file \"" << file_name << "\" is empty.");
-            is_good_file_name = false;
-        }
-    }
-    sp_params.release();
-
-    return is_good_file_name;
-}
-
+//-----------------------------------------------------------------------------
 
-void OcvDnnDetection::OcvDnnJobConfig::getSpectralHashInfo(std::string hash_file_list,
-                                                         const std::vector<cv::String> &net_layers,
-                                                         const std::string &model_name,
-                                                         const log4cxx::LoggerPtr &logger) {
-    LOG4CXX_DEBUG(logger, "Loading spectral hash parameters");
-    if (!hash_file_list.empty()) {
-        boost::trim(hash_file_list);
-        std::vector<std::string> files;
-        boost::split(files, hash_file_list,
-                     boost::is_any_of(" ;"),
-                     boost::token_compress_on);
-
-        for (const std::string &file_name : files) {
-            LOG4CXX_DEBUG(logger, "file_name = " << file_name);
-            std::string err_string;
-            std::string exp_filename;
-            err_string = Utils::expandFileName(file_name, exp_filename);
-            if (!err_string.empty()) {
-                LOG4CXX_WARN(logger, "Expansion of spectral hash input filename \"" << file_name << "\" failed: error reported was \"" << err_string << "\"");
-                bad_hash_file_names.push_back(file_name);
-            }
-            else {
-                SpectralHashInfo hash_info;
-                try {
-                    cv::FileStorage sp_params(exp_filename, cv::FileStorage::READ);
-                    if (!sp_params.isOpened()) {
-                        LOG4CXX_WARN(logger, "Failed to open spectral hash file named \"" << exp_filename << "\"");
-                        bad_hash_file_names.push_back(file_name);
-                    }
-                    else {
-                        if (sp_params["layer_name"].empty()) {
-                            LOG4CXX_WARN(logger, "The \"layer_name\" field in file \"" << exp_filename << "\" is missing.");
-                            bad_hash_file_names.push_back(file_name);
-                        }
-                        else {
-                            sp_params["layer_name"] >> hash_info.layer_name;
-                            LOG4CXX_DEBUG(logger, "layer_name = " << hash_info.layer_name);
-                            if (std::find(net_layers.begin(),
-                                          net_layers.end(),
-                                          hash_info.layer_name) != net_layers.end()) {
-                                bool is_good_file = parseAndValidateHashInfo(exp_filename,
-                                                                             sp_params,
-                                                                             hash_info,
-                                                                             logger);
-                                if (is_good_file) {
-                                    // Everything checks out ok, so
-                                    // save the hash info and the
-                                    // layer name. Also save the
-                                    // original file name in case
-                                    // there is a subsequent error in
-                                    // the spectral hash calculation;
-                                    // we can then add the file to the
-                                    // list of bad files.
-                                    hash_info.file_name = file_name;
-                                    hash_info.model_name = model_name;
-                                    spectral_hash_info.push_back(hash_info);
-                                }
-                                else {
-                                    bad_hash_file_names.push_back(file_name);
-                                }
-                            }
-                            else {
-                                LOG4CXX_WARN(logger, "Layer named \"" << hash_info.layer_name
-                                             << "\" from spectral hash file \"" << file_name
-                                             << "\" was not found in the model named \"" << model_name << "\"");
-                                bad_hash_file_names.push_back(file_name);
-                            }
-                        }
-                    }
-                } catch(const cv::Exception &err){
-                    LOG4CXX_WARN(logger, "Exception caught when processing spectral hash file named \""
-                                 << file_name << "\": " << err.what());
-                    bad_hash_file_names.push_back(file_name);
-                }
-            }
-        }
-    }
-}
+MPF_COMPONENT_CREATOR(OcvDnnDetection);
+MPF_COMPONENT_DELETER();
@@ -0,0 +1,261 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "OcvDnnStreamingDetection.h"
+
+#include <exception>
+#include <sstream>
+#include <utility>
+
+#include <log4cxx/xml/domconfigurator.h>
+
+#include <detectionComponentUtils.h>
+#include <MPFInvalidPropertyException.h>
+
+
+using namespace MPF::COMPONENT;
+
+
+namespace {
+    [[noreturn]] void logError(const std::string &message, const log4cxx::LoggerPtr &logger) {
+        try {
+            throw;
+        }
+        catch (const std::exception &ex) {
+            LOG4CXX_ERROR(logger, message << ": " << ex.what());
+            throw;
+        }
+        catch (...) {
+            LOG4CXX_ERROR(logger, message << ".");
+            throw;
+        }
+    }
+}
+
+
+
+OcvDnnStreamingDetection::OcvDnnStreamingDetection(const MPFStreamingVideoJob &job)
+try
+        : MPFStreamingDetectionComponent(job)
+        , job_name_(job.job_name)
+        , log_prefix_("[" + job.job_name + "] ")
+        , frame_interval_(DetectionComponentUtils::GetProperty(job.job_properties, "STREAMING_FRAME_INTERVAL", 1))
+{
+    log4cxx::xml::DOMConfigurator::configure(job.run_directory + "/OcvDnnDetection/config/Log4cxxConfig.xml");
+    logger_ = log4cxx::Logger::getLogger("OcvDnnStreamingDetection");
+    classifier_.init(job.run_directory + "/OcvDnnDetection", logger_);
+
+    if (frame_interval_ < 1) {
+        throw MPFInvalidPropertyException(
+                "STREAMING_FRAME_INTERVAL",
+                "The value, " + std::to_string(frame_interval_) + ", is not valid. It must be greater than 0.");
+    }
+
+    config_.reset(new OcvDnnClassifier::OcvDnnJobConfig(job.job_properties, classifier_));
+    config_->media_path = job.job_name;
+    LOG4CXX_INFO(logger_, log_prefix_ << "Loaded model for streaming job.");
+}
+catch (...) {
+    ::logError("An error occurred while initializing job \"" + job.job_name + "\"",
+               log4cxx::Logger::getLogger("OcvDnnStreamingDetection"));
+}
+
+
+OcvDnnStreamingDetection::~OcvDnnStreamingDetection() {
+    stopSegment();
+}
+
+
+std::string OcvDnnStreamingDetection::GetDetectionType() {
+    return "CLASS";
+}
+
+
+void OcvDnnStreamingDetection::BeginSegment(const VideoSegmentInfo &segment_info) {
+    try {
+        // EndSegment normally finishes the previous segment, unless it was not called because of an error.
+        stopSegment();
+
+        std::ostringstream ss;
+        ss << "[" << job_name_ << ": Segment #" << segment_info.segment_number
+           << " (" << segment_info.start_frame << " - " << segment_info.end_frame << ")] ";
+        log_prefix_ = ss.str();
+
+        segment_start_frame_ = segment_info.start_frame;
+        segment_end_frame_ = segment_info.end_frame;
+        found_detection_in_segment_ = false;
+        reported_detection_in_segment_ = false;
+        num_queued_frames_ = 0;
+        end_of_segment_queued_ = false;
+        frame_queue_.reset(new OcvDnnClassifier::FrameQueue(config_->frame_queue_capacity));
+        segment_tracks_future_ = std::async(std::launch::async, &OcvDnnStreamingDetection::classifySegmentFrames,
+                                            this);
+    }
+    catch (...) {
+        logError("An error occurred while starting segment");
+    }
+}
+
+
+bool OcvDnnStreamingDetection::ProcessFrame(const cv::Mat &frame, int frame_number) {
+    try {
+        if ((frame_number - segment_start_frame_) % frame_interval_ == 0) {
+            // The frame is resized on this thread so that the caller's frame does not need to be copied.
+            std::unique_ptr<OcvDnnClassifier::QueuedFrame> queued_frame(new OcvDnnClassifier::QueuedFrame{
+                    frame_number, OcvDnnClassifier::preprocessFrame(*config_, frame), frame.size() });
+            num_queued_frames_++;
+            try {
+                // Blocks when the network falls behind by more than FRAME_QUEUE_CAPACITY frames.
+                frame_queue_->push(std::move(queued_frame));
+            }
+            catch (const QueueHaltedException &) {
+                // The inference thread failed, so re-throw its exception.
+                segment_tracks_future_.get();
+                throw;
+            }
+        }
+
+        if (frame_number == segment_end_frame_ && !reported_detection_in_segment_) {
+            // No more frames will be added to the segment, so the remaining frames are classified now. Otherwise, a
+            // detection in the last few frames would not be reported until EndSegment.
+            queueEndOfSegment();
+            segment_tracks_future_.wait();
+        }
+
+        // Detections are found asynchronously, so the first detection is reported on the first call after the
+        // inference thread finds it.
+        if (found_detection_in_segment_ && !reported_detection_in_segment_) {
+            LOG4CXX_INFO(logger_, log_prefix_ << "Found first detection in segment by frame number: " << frame_number);
+            reported_detection_in_segment_ = true;
+            return true;
+        }
+        return false;
+    }
+    catch (...) {
+        logError("An error occurred while processing frame " + std::to_string(frame_number));
+    }
+}
+
+
+std::vector<MPFVideoTrack> OcvDnnStreamingDetection::EndSegment() {
+    queueEndOfSegment();
+    try {
+        std::vector<MPFVideoTrack> tracks = segment_tracks_future_.get();
+        frame_queue_.reset();
+        LOG4CXX_INFO(logger_, log_prefix_ << "End segment. " << tracks.size() << " tracks reported.");
+        return tracks;
+    }
+    catch (...) {
+        frame_queue_.reset();
+        logError("An error occurred while generating tracks for segment");
+    }
+}
+
+
+std::vector<MPFVideoTrack> OcvDnnStreamingDetection::classifySegmentFrames() {
+    try {
+        std::vector<MPFVideoTrack> tracks;
+        std::vector<std::unique_ptr<OcvDnnClassifier::QueuedFrame>> batch;
+        std::vector<cv::Mat> batch_frames;
+        std::vector<OcvDnnClassifier::NetworkOutput> network_outputs;
+
+        bool end_of_segment = false;
+        while (!end_of_segment) {
+            std::unique_ptr<OcvDnnClassifier::QueuedFrame> queued_frame = frame_queue_->pop();
+            if (queued_frame == nullptr) {
+                end_of_segment = true;
+            }
+            else {
+                num_queued_frames_--;
+                batch_frames.push_back(queued_frame->frame);
+                batch.push_back(std::move(queued_frame));
+            }
+
+            // When the network is keeping up with ProcessFrame, waiting for a full batch would only delay the
+            // detections, so a partial batch is run as soon as there are no more frames in the queue.
+            bool queue_idle = num_queued_frames_ == 0;
+            if (batch.empty() || (batch.size() < config_->batch_size && !end_of_segment && !queue_idle)) {
+                continue;
+            }
+
+            OcvDnnClassifier::getNetworkOutput(*config_, batch_frames, network_outputs);
+            for (int i = 0; i < batch.size(); i++) {
+                std::unique_ptr<MPFImageLocation> location = classifier_.createDetection(
+                        *config_, batch[i]->original_frame_size, batch[i]->frame_index, network_outputs[i]);
+                if (location) {
+                    found_detection_in_segment_ = true;
+                    OcvDnnClassifier::defaultTracker(config_->classification_type, *location, batch[i]->frame_index,
+                                                     tracks);
+                }
+            }
+            batch.clear();
+            batch_frames.clear();
+        }
+        return tracks;
+    }
+    catch (...) {
+        // Make ProcessFrame and EndSegment stop waiting for space in the queue.
+        frame_queue_->halt();
+        throw; // Exception will be re-thrown when the future's get() is called.
+    }
+}
+
+
+void OcvDnnStreamingDetection::queueEndOfSegment() {
+    if (end_of_segment_queued_) {
+        return;
+    }
+    end_of_segment_queued_ = true;
+    try {
+        frame_queue_->push(nullptr);
+    }
+    catch (const QueueHaltedException &) {
+        // The inference thread failed. Its exception is re-thrown when segment_tracks_future_.get() is called.
+    }
+}
+
+
+void OcvDnnStreamingDetection::stopSegment() {
+    if (!segment_tracks_future_.valid()) {
+        return;
+    }
+    frame_queue_->halt();
+    try {
+        segment_tracks_future_.get();
+    }
+    catch (...) {
+        // The segment is being abandoned, so its results and errors are discarded.
+    }
+    frame_queue_.reset();
+}
+
+
+void OcvDnnStreamingDetection::logError(const std::string &message) {
+    ::logError(log_prefix_ + message, logger_);
+}
+
+
+EXPORT_MPF_STREAMING_COMPONENT(OcvDnnStreamingDetection);
@@ -0,0 +1,111 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+#ifndef OPENMPF_COMPONENTS_OCVDNNSTREAMINGDETECTION_H
+#define OPENMPF_COMPONENTS_OCVDNNSTREAMINGDETECTION_H
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <log4cxx/logger.h>
+
+#include <BlockingQueue.h>
+#include <MPFDetectionObjects.h>
+#include <MPFStreamingDetectionComponent.h>
+
+#include "OcvDnnClassifier.h"
+
+
+class OcvDnnStreamingDetection : public MPF::COMPONENT::MPFStreamingDetectionComponent {
+
+public:
+    explicit OcvDnnStreamingDetection(const MPF::COMPONENT::MPFStreamingVideoJob &job);
+
+    ~OcvDnnStreamingDetection() override;
+
+    std::string GetDetectionType() override;
+
+    void BeginSegment(const MPF::COMPONENT::VideoSegmentInfo &segment_info) override;
+
+    bool ProcessFrame(const cv::Mat &frame, int frame_number) override;
+
+    std::vector<MPF::COMPONENT::MPFVideoTrack> EndSegment() override;
+
+private:
+    log4cxx::LoggerPtr logger_;
+
+    std::string job_name_;
+
+    std::string log_prefix_;
+
+    // Owns the network, which stays loaded for the lifetime of the job.
+    OcvDnnClassifier classifier_;
+
+    std::unique_ptr<OcvDnnClassifier::OcvDnnJobConfig> config_;
+
+    // Only every frame_interval_-th frame of a segment is classified.
+    int frame_interval_;
+
+    int segment_start_frame_ = 0;
+
+    int segment_end_frame_ = 0;
+
+    // Frames are preprocessed in ProcessFrame and then run through the network on the thread started by
+    // BeginSegment. A nullptr in the queue indicates the end of the segment. A new queue is created for each segment
+    // because a queue can not be reused after it is halted.
+    std::unique_ptr<OcvDnnClassifier::FrameQueue> frame_queue_;
+
+    // The number of frames that have been added to frame_queue_, but not yet removed by the inference thread. When
+    // there are no more frames waiting, the inference thread runs a partial batch instead of waiting for it to fill.
+    std::atomic<int> num_queued_frames_{ 0 };
+
+    bool end_of_segment_queued_ = false;
+
+    std::future<std::vector<MPF::COMPONENT::MPFVideoTrack>> segment_tracks_future_;
+
+    // Set by the inference thread when it finds the first detection in the segment.
+    std::atomic<bool> found_detection_in_segment_{ false };
+
+    bool reported_detection_in_segment_ = false;
+
+    // Runs on the thread started by BeginSegment.
+    std::vector<MPF::COMPONENT::MPFVideoTrack> classifySegmentFrames();
+
+    // Adds the nullptr that tells the inference thread that there are no more frames in the segment.
+    void queueEndOfSegment();
+
+    // Halts the current segment's queue and waits for the inference thread to exit.
+    void stopSegment();
+
+    [[noreturn]] void logError(const std::string &message);
+};
+
+
+#endif //OPENMPF_COMPONENTS_OCVDNNSTREAMINGDETECTION_H
@@ -0,0 +1,425 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "OcvDnnDetection.h"
+
+using namespace MPF::COMPONENT;
+
+
+namespace {
+
+    struct BenchmarkModel {
+        std::string name;
+        Properties properties;
+        // Used to measure the cost of reporting activation values.
+        std::string output_layer;
+        // Empty when there is no spectral hash file for the model.
+        std::string spectral_hash_file;
+    };
+
+
+    // Returns the names of the [sections] in the component's models.ini file.
+    std::vector<std::string> getModelNames(const std::string &models_ini_path) {
+        std::ifstream models_ini(models_ini_path);
+        if (!models_ini) {
+            throw std::runtime_error("Could not open \"" + models_ini_path + "\".");
+        }
+        std::vector<std::string> model_names;
+        std::string line;
+        while (std::getline(models_ini, line)) {
+            if (line.size() > 2 && line.front() == '[' && line.back() == ']') {
+                model_names.push_back(line.substr(1, line.size() - 2));
+            }
+        }
+        return model_names;
+    }
+
+
+    // Uses the job properties from the first action in the component's descriptor that runs the model on whole
+    // frames. Models without an action only set MODEL_NAME, so they run with the component's default properties.
+    BenchmarkModel getBenchmarkModel(const std::string &run_dir, const std::string &model_name) {
+        BenchmarkModel model { model_name, { { "MODEL_NAME", model_name } }, "prob", "" };
+
+        cv::FileStorage descriptor(run_dir + "/OcvDnnDetection/descriptor/descriptor.json",
+                                   cv::FileStorage::READ | cv::FileStorage::FORMAT_JSON);
+        if (!descriptor.isOpened()) {
+            return model;
+        }
+
+        bool found_action = false;
+        for (const cv::FileNode &action : descriptor["actions"]) {
+            Properties action_props;
+            for (const cv::FileNode &property : action["properties"]) {
+                action_props[static_cast<std::string>(property["name"])]
+                        = static_cast<std::string>(property["value"]);
+            }
+            auto model_name_iter = action_props.find("MODEL_NAME");
+            if (model_name_iter == action_props.end() || model_name_iter->second != model_name) {
+                continue;
+            }
+
+            auto spectral_hash_iter = action_props.find("SPECTRAL_HASH_FILE_LIST");
+            if (model.spectral_hash_file.empty() && spectral_hash_iter != action_props.end()) {
+                std::string spectral_hash_file = spectral_hash_iter->second;
+                const std::string plugins_dir = "${MPF_HOME}/plugins";
+                if (spectral_hash_file.compare(0, plugins_dir.size(), plugins_dir) == 0) {
+                    spectral_hash_file.replace(0, plugins_dir.size(), run_dir);
+                }
+                model.spectral_hash_file = spectral_hash_file;
+            }
+
+            if (!found_action && action_props.count("FEED_FORWARD_TYPE") == 0) {
+                found_action = true;
+                // The benchmark adds its own output options.
+                action_props.erase("ACTIVATION_LAYER_LIST");
+                action_props.erase("SPECTRAL_HASH_FILE_LIST");
+                auto output_layer_iter = action_props.find("MODEL_OUTPUT_LAYER");
+                if (output_layer_iter != action_props.end()) {
+                    model.output_layer = output_layer_iter->second;
+                }
+                model.properties = action_props;
+            }
+        }
+        return model;
+    }
+
+
+    std::vector<std::string> splitList(const std::string &list) {
+        std::vector<std::string> items;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+
+    std::vector<int> parseIntList(const std::string &list) {
+        std::vector<int> values;
+        for (const std::string &item : splitList(list)) {
+            values.push_back(std::stoi(item));
+        }
+        return values;
+    }
+
+
+    bool isImage(const std::string &uri) {
+        std::string extension = uri.substr(uri.find_last_of('.') + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "bmp"
+               || extension == "tif" || extension == "tiff" || extension == "gif";
+    }
+
+
+    // Returns the value of a memory usage field, like VmRSS or VmHWM, from /proc/self/status in kilobytes.
+    long getMemoryUsageKb(const std::string &field) {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, field.size() + 1, field + ":") == 0) {
+                return std::stol(line.substr(field.size() + 1));
+            }
+        }
+        return -1;
+    }
+
+
+    template <typename Func>
+    double timeMs(Func func) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+
+    // Returns the nearest-rank percentile of the sorted values.
+    double percentile(const std::vector<double> &sorted_values, double percent) {
+        size_t rank = static_cast<size_t>(std::ceil(percent / 100 * sorted_values.size()));
+        return sorted_values.at(std::max<size_t>(rank, 1) - 1);
+    }
+
+
+    // Writes the first frame_count frames of the video to uncompressed BMP files in dir, so that each frame can be
+    // timed with its own image job without including the cost of seeking in and decoding the video.
+    std::vector<std::string> extractFrames(const std::string &video_uri, int frame_count, const std::string &dir) {
+        cv::VideoCapture video(video_uri);
+        std::vector<std::string> frame_paths;
+        cv::Mat frame;
+        while (frame_paths.size() < frame_count && video.read(frame)) {
+            std::string frame_path = dir + "/frame-" + std::to_string(frame_paths.size()) + ".bmp";
+            if (!cv::imwrite(frame_path, frame)) {
+                throw std::runtime_error("Could not write \"" + frame_path + "\".");
+            }
+            frame_paths.push_back(frame_path);
+        }
+        return frame_paths;
+    }
+
+
+    void removeFrames(const std::vector<std::string> &frame_paths) {
+        for (const std::string &frame_path : frame_paths) {
+            std::remove(frame_path.c_str());
+        }
+    }
+
+
+    void printUsage(const char *program) {
+        std::cout << "Usage: " << program << " [options] <output-json-file> <uri>..." << std::endl
+                  << "Options:" << std::endl
+                  << "  --models <list>              Comma-separated model names. Default: every model in models.ini" << std::endl
+                  << "  --batch-sizes <list>         BATCH_SIZE values to use for videos. Default: 1,4,8" << std::endl
+                  << "  --thread-counts <list>       Values passed to cv::setNumThreads. Default: the OpenCV default" << std::endl
+                  << "  --repetitions <n>            Number of timed runs for each configuration. Default: 5" << std::endl
+                  << "  --max-video-frames <n>       Maximum number of frames to process from each video. Default: 100" << std::endl
+                  << "  --run-directory <dir>        Directory containing the OcvDnnDetection plugin. Default: plugin" << std::endl;
+    }
+}
+
+
+// Runs every combination of model, output options, OpenCV thread count, input media, and batch size through the
+// component, and writes the throughput, per-frame latency, and memory usage of each combination to a JSON file.
+int main(int argc, char* argv[]) {
+    try {
+        std::vector<std::string> model_names;
+        std::vector<int> batch_sizes { 1, 4, 8 };
+        std::vector<int> thread_counts { cv::getNumThreads() };
+        int repetitions = 5;
+        int max_video_frames = 100;
+        std::string run_dir = "plugin";
+        std::vector<std::string> positional_args;
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            bool has_value = i + 1 < argc;
+            if (arg == "--models" && has_value) {
+                model_names = splitList(argv[++i]);
+            }
+            else if (arg == "--batch-sizes" && has_value) {
+                batch_sizes = parseIntList(argv[++i]);
+            }
+            else if (arg == "--thread-counts" && has_value) {
+                thread_counts = parseIntList(argv[++i]);
+            }
+            else if (arg == "--repetitions" && has_value) {
+                repetitions = std::stoi(argv[++i]);
+            }
+            else if (arg == "--max-video-frames" && has_value) {
+                max_video_frames = std::stoi(argv[++i]);
+            }
+            else if (arg == "--run-directory" && has_value) {
+                run_dir = argv[++i];
+            }
+            else if (arg.compare(0, 2, "--") == 0) {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            else {
+                positional_args.push_back(arg);
+            }
+        }
+
+        if (positional_args.size() < 2 || repetitions < 1 || max_video_frames < 1) {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        std::string output_file = positional_args.front();
+        std::vector<std::string> uris(positional_args.begin() + 1, positional_args.end());
+
+        std::vector<std::string> ini_model_names = getModelNames(run_dir + "/OcvDnnDetection/models/models.ini");
+        if (model_names.empty()) {
+            model_names = ini_model_names;
+        }
+        for (const std::string &model_name : model_names) {
+            if (std::find(ini_model_names.begin(), ini_model_names.end(), model_name) == ini_model_names.end()) {
+                std::cerr << "Error: Unknown model \"" << model_name << "\"." << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        OcvDnnDetection ocv_dnn_component;
+        ocv_dnn_component.SetRunDirectory(run_dir);
+        if (!ocv_dnn_component.Init()) {
+            std::cout << "Component initialization failed, exiting." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        cv::FileStorage report(output_file, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_JSON);
+        if (!report.isOpened()) {
+            std::cerr << "Error: Could not open \"" << output_file << "\" for writing." << std::endl;
+            return EXIT_FAILURE;
+        }
+        report << "opencv_version" << CV_VERSION;
+        report << "results" << "[";
+
+        // Video frames are extracted to this directory to time them individually.
+        char dir_template[] = "/tmp/ocv_dnn_benchmark-XXXXXX";
+        if (mkdtemp(dir_template) == nullptr) {
+            std::cerr << "Error: Could not create a temporary directory." << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::string frames_dir = dir_template;
+
+        for (const std::string &model_name : model_names) {
+            BenchmarkModel model = getBenchmarkModel(run_dir, model_name);
+
+            // (output option name, properties to add)
+            std::vector<std::pair<std::string, Properties>> output_options {
+                    { "classification", {} },
+                    { "activation_layers", { { "ACTIVATION_LAYER_LIST", model.output_layer } } }
+            };
+            if (!model.spectral_hash_file.empty()) {
+                output_options.push_back({ "spectral_hash", { { "SPECTRAL_HASH_FILE_LIST", model.spectral_hash_file } } });
+            }
+
+            for (const auto &output_option : output_options) {
+                for (int thread_count : thread_counts) {
+                    cv::setNumThreads(thread_count);
+
+                    for (const std::string &uri : uris) {
+                        bool is_image = isImage(uri);
+                        int frame_count = 1;
+                        std::vector<std::string> frame_paths { uri };
+                        if (!is_image) {
+                            frame_paths = extractFrames(uri, max_video_frames, frames_dir);
+                            frame_count = frame_paths.size();
+                            if (frame_count < 1) {
+                                rmdir(frames_dir.c_str());
+                                std::cerr << "Error: Could not read frames from \"" << uri << "\"." << std::endl;
+                                return EXIT_FAILURE;
+                            }
+                        }
+
+                        Properties job_props = model.properties;
+                        job_props.insert(output_option.second.begin(), output_option.second.end());
+
+                        // The component only reports when a whole job completes, so each frame is timed with its
+                        // own single-frame image job. The first job is not timed, because it loads the model.
+                        ocv_dnn_component.GetDetections(MPFImageJob("Benchmark", frame_paths.front(), job_props, {}));
+                        std::vector<double> frame_ms;
+                        for (int rep = 0; rep < repetitions; rep++) {
+                            for (const std::string &frame_path : frame_paths) {
+                                MPFImageJob job("Benchmark", frame_path, job_props, {});
+                                frame_ms.push_back(timeMs([&] { ocv_dnn_component.GetDetections(job); }));
+                            }
+                        }
+                        std::sort(frame_ms.begin(), frame_ms.end());
+                        if (!is_image) {
+                            removeFrames(frame_paths);
+                        }
+
+                        report << "{";
+                        report << "model" << model.name;
+                        report << "output" << output_option.first;
+                        report << "thread_count" << thread_count;
+                        report << "uri" << uri;
+                        report << "media_type" << (is_image ? "IMAGE" : "VIDEO");
+                        report << "frame_count" << frame_count;
+                        report << "frame_ms_p50" << percentile(frame_ms, 50);
+                        report << "frame_ms_p90" << percentile(frame_ms, 90);
+                        report << "frame_ms_p99" << percentile(frame_ms, 99);
+                        report << "frame_ms_max" << frame_ms.back();
+                        report << "batches" << "[";
+
+                        // Batching only applies to videos.
+                        std::vector<int> job_batch_sizes = is_image ? std::vector<int>{ 1 } : batch_sizes;
+                        for (int batch_size : job_batch_sizes) {
+                            job_props["BATCH_SIZE"] = std::to_string(batch_size);
+
+                            auto run_job = [&] {
+                                if (is_image) {
+                                    MPFImageJob job("Benchmark", uri, job_props, {});
+                                    ocv_dnn_component.GetDetections(job);
+                                }
+                                else {
+                                    MPFVideoJob job("Benchmark", uri, 0, frame_count - 1, job_props, {});
+                                    ocv_dnn_component.GetDetections(job);
+                                }
+                            };
+
+                            // Clear the component's network cache so that the first job includes the time it
+                            // takes to load the model.
+                            ocv_dnn_component.clearCaches();
+                            double cold_start_ms = timeMs(run_job);
+
+                            double total_ms = 0;
+                            for (int rep = 0; rep < repetitions; rep++) {
+                                total_ms += timeMs(run_job);
+                            }
+                            double fps = 1000.0 * frame_count * repetitions / total_ms;
+
+                            std::cout << model.name << " " << output_option.first << " threads=" << thread_count
+                                      << " batch=" << batch_size << " " << uri << ": " << fps << " fps, "
+                                      << percentile(frame_ms, 50) << " ms/frame median, "
+                                      << percentile(frame_ms, 99) << " ms/frame p99" << std::endl;
+
+                            report << "{";
+                            report << "batch_size" << batch_size;
+                            report << "cold_start_ms" << cold_start_ms;
+                            report << "fps" << fps;
+                            report << "rss_kb" << static_cast<int>(getMemoryUsageKb("VmRSS"));
+                            report << "peak_rss_kb" << static_cast<int>(getMemoryUsageKb("VmHWM"));
+                            report << "}";
+                        }
+                        report << "]";
+                        report << "}";
+                    }
+                }
+            }
+        }
+
+        report << "]";
+        report.release();
+        ocv_dnn_component.Close();
+        rmdir(frames_dir.c_str());
+        std::cout << "Wrote report to " << output_file << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -24,12 +24,25 @@
  * limitations under the License.                                             *
  ******************************************************************************/
 
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
 #include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <MPFDetectionComponent.h>
+#include <MPFVideoCapture.h>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
 
 #include <gtest/gtest.h>
 
 #include "OcvDnnDetection.h"
+#include "OcvDnnStreamingDetection.h"
 
 using namespace MPF::COMPONENT;
 
@@ -113,6 +126,67 @@ TEST(OCVDNN, GoogleNetImageTest) {
 }
 
 
+std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ';')) {
+        items.push_back(item.substr(item.find_first_not_of(' ')));
+    }
+    return items;
+}
+
+
+TEST(OCVDNN, TopNClassificationsTest) {
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    // With a threshold of 0, all 1000 classes pass, so asking for 5 takes the partial selection path, while asking
+    // for all 1000 sorts every class. Both must rank the classes the same way, including the order of ties.
+    Properties job_props = getGoogleNetProperties();
+    job_props["CONFIDENCE_THRESHOLD"] = "0";
+
+    job_props["NUMBER_OF_CLASSIFICATIONS"] = "1000";
+    MPFImageJob all_classes_job("Test", "data/sundial.jpg", job_props, {});
+    std::vector<MPFImageLocation> all_classes_locations = ocv_dnn_component.GetDetections(all_classes_job);
+    ASSERT_EQ(all_classes_locations.size(), 1);
+    Properties &all_classes_props = all_classes_locations.front().detection_properties;
+    std::vector<std::string> all_names = splitList(all_classes_props["CLASSIFICATION LIST"]);
+    std::vector<std::string> all_confidences = splitList(all_classes_props["CLASSIFICATION CONFIDENCE LIST"]);
+    ASSERT_EQ(all_names.size(), 1000);
+    ASSERT_EQ(all_confidences.size(), 1000);
+    for (int i = 1; i < all_confidences.size(); i++) {
+        ASSERT_GE(std::stof(all_confidences[i - 1]), std::stof(all_confidences[i]));
+    }
+
+    job_props["NUMBER_OF_CLASSIFICATIONS"] = "5";
+    MPFImageJob top_5_job("Test", "data/sundial.jpg", job_props, {});
+    std::vector<MPFImageLocation> top_5_locations = ocv_dnn_component.GetDetections(top_5_job);
+    ASSERT_EQ(top_5_locations.size(), 1);
+    Properties &top_5_props = top_5_locations.front().detection_properties;
+    ASSERT_EQ(top_5_props["CLASSIFICATION"], "sundial");
+    std::vector<std::string> top_5_names = splitList(top_5_props["CLASSIFICATION LIST"]);
+    std::vector<std::string> top_5_confidences = splitList(top_5_props["CLASSIFICATION CONFIDENCE LIST"]);
+    ASSERT_EQ(top_5_names, std::vector<std::string>(all_names.begin(), all_names.begin() + 5));
+    ASSERT_EQ(top_5_confidences, std::vector<std::string>(all_confidences.begin(), all_confidences.begin() + 5));
+
+    for (const std::string &invalid_count : { "0", "-1" }) {
+        job_props["NUMBER_OF_CLASSIFICATIONS"] = invalid_count;
+        MPFImageJob invalid_job("Test", "data/sundial.jpg", job_props, {});
+        try {
+            ocv_dnn_component.GetDetections(invalid_job);
+            FAIL() << "Expected MPFDetectionException to be thrown.";
+        }
+        catch (const MPFDetectionException &ex) {
+            ASSERT_EQ(ex.error_code, MPF_INVALID_PROPERTY);
+        }
+    }
+
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
+
 void assertObjectDetectedInVideo(const std::string &object_name, const Properties &job_props, OcvDnnDetection &ocv_dnn_component) {
     MPFVideoJob job("TEST", "data/ff-region-object-motion.avi", 10, 15, job_props, {});
 
@@ -142,6 +216,233 @@ TEST(OCVDNN, GoogleNetVideoTest) {
 }
 
 
+void assertSameTracks(const std::vector<MPFVideoTrack> &expected_tracks,
+                      const std::vector<MPFVideoTrack> &actual_tracks) {
+    ASSERT_EQ(expected_tracks.size(), actual_tracks.size());
+    for (int i = 0; i < expected_tracks.size(); i++) {
+        const MPFVideoTrack &expected_track = expected_tracks[i];
+        const MPFVideoTrack &actual_track = actual_tracks[i];
+        ASSERT_EQ(expected_track.start_frame, actual_track.start_frame);
+        ASSERT_EQ(expected_track.stop_frame, actual_track.stop_frame);
+        ASSERT_EQ(expected_track.detection_properties.at("CLASSIFICATION"),
+                  actual_track.detection_properties.at("CLASSIFICATION"));
+        ASSERT_NEAR(expected_track.confidence, actual_track.confidence, 0.001);
+        ASSERT_EQ(expected_track.frame_locations.size(), actual_track.frame_locations.size());
+
+        for (const auto &frame_location_pair : expected_track.frame_locations) {
+            const MPFImageLocation &actual_location = actual_track.frame_locations.at(frame_location_pair.first);
+            ASSERT_EQ(frame_location_pair.second.detection_properties.at("CLASSIFICATION LIST"),
+                      actual_location.detection_properties.at("CLASSIFICATION LIST"));
+        }
+    }
+}
+
+
+TEST(OCVDNN, BatchedVideoTest) {
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    Properties job_props = getGoogleNetProperties();
+    job_props["NUMBER_OF_CLASSIFICATIONS"] = "3";
+    MPFVideoJob job("TEST", "data/ff-region-object-motion.avi", 10, 15, job_props, {});
+    std::vector<MPFVideoTrack> unbatched_tracks = ocv_dnn_component.GetDetections(job);
+    ASSERT_FALSE(unbatched_tracks.empty());
+
+    // 6 frames are processed, so the last batch is only partially filled.
+    job_props["BATCH_SIZE"] = "4";
+    MPFVideoJob batched_job("TEST", "data/ff-region-object-motion.avi", 10, 15, job_props, {});
+    ASSERT_NO_FATAL_FAILURE(assertSameTracks(unbatched_tracks, ocv_dnn_component.GetDetections(batched_job)));
+
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
+
+TEST(OCVDNN, MultiplePreprocessingThreadsVideoTest) {
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    Properties job_props = getGoogleNetProperties();
+    job_props["NUMBER_OF_CLASSIFICATIONS"] = "3";
+    MPFVideoJob job("TEST", "data/ff-region-object-motion.avi", 0, 19, job_props, {});
+    std::vector<MPFVideoTrack> single_thread_tracks = ocv_dnn_component.GetDetections(job);
+    ASSERT_FALSE(single_thread_tracks.empty());
+
+    // Frames may finish preprocessing out of order, but they must be reported in order.
+    job_props["PREPROCESSING_THREAD_COUNT"] = "3";
+    job_props["FRAME_QUEUE_CAPACITY"] = "1";
+    job_props["BATCH_SIZE"] = "2";
+    MPFVideoJob multi_thread_job("TEST", "data/ff-region-object-motion.avi", 0, 19, job_props, {});
+    ASSERT_NO_FATAL_FAILURE(assertSameTracks(single_thread_tracks, ocv_dnn_component.GetDetections(multi_thread_job)));
+
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
+
+TEST(OCVDNN, FrameSkippingVideoTest) {
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    Properties job_props = getGoogleNetProperties();
+    MPFVideoJob job("TEST", "data/ff-region-object-motion.avi", 0, 15, job_props, {});
+    std::vector<MPFVideoTrack> unskipped_tracks = ocv_dnn_component.GetDetections(job);
+    ASSERT_FALSE(unskipped_tracks.empty());
+
+    // No frames can be skipped when MAX_SKIPPED_FRAMES is 0.
+    job_props["FRAME_DIFFERENCE_THRESHOLD"] = "1.0";
+    job_props["MAX_SKIPPED_FRAMES"] = "0";
+    MPFVideoJob no_skip_job("TEST", "data/ff-region-object-motion.avi", 0, 15, job_props, {});
+    ASSERT_NO_FATAL_FAILURE(assertSameTracks(unskipped_tracks, ocv_dnn_component.GetDetections(no_skip_job)));
+
+    // Every frame is similar enough to be skipped, so the network only runs on frames 0, 5, 10, and 15.
+    job_props["MAX_SKIPPED_FRAMES"] = "4";
+    job_props["BATCH_SIZE"] = "3";
+    job_props["ACTIVATION_LAYER_LIST"] = "prob";
+    MPFVideoJob skip_job("TEST", "data/ff-region-object-motion.avi", 0, 15, job_props, {});
+    std::vector<MPFVideoTrack> skipped_tracks = ocv_dnn_component.GetDetections(skip_job);
+
+    int num_frames = 0;
+    for (const MPFVideoTrack &track : skipped_tracks) {
+        for (const auto &frame_location_pair : track.frame_locations) {
+            num_frames++;
+            int frame_index = frame_location_pair.first;
+            const Properties &properties = frame_location_pair.second.detection_properties;
+            if (frame_index % 5 == 0) {
+                ASSERT_EQ(1, properties.count("PROB ACTIVATION MATRIX"));
+            }
+            else {
+                // Skipped frames have the same classification as the most recent classified frame, but not its
+                // activations, because the network did not run on them.
+                int classified_frame_index = frame_index - frame_index % 5;
+                const MPFImageLocation &classified_location = track.frame_locations.at(classified_frame_index);
+                Properties expected_properties = classified_location.detection_properties;
+                expected_properties.erase("PROB ACTIVATION MATRIX");
+                ASSERT_EQ(expected_properties, properties);
+                ASSERT_EQ(classified_location.confidence, frame_location_pair.second.confidence);
+            }
+        }
+    }
+    ASSERT_EQ(16, num_frames);
+
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
+
+// Creates an empty directory that the caller is responsible for removing. Returns an empty string on failure.
+std::string createTempDirectory() {
+    char dir_template[] = "/tmp/ocv_dnn_test-XXXXXX";
+    char *dir = mkdtemp(dir_template);
+    return dir == nullptr ? std::string() : std::string(dir);
+}
+
+
+std::string readFile(const std::string &path) {
+    std::ifstream file(path);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+
+void getSavedBackend(const std::string &benchmark_file, std::string &backend, std::string &target) {
+    cv::FileStorage file_storage(benchmark_file, cv::FileStorage::READ);
+    ASSERT_TRUE(file_storage.isOpened());
+    cv::FileNode benchmarks = file_storage["benchmarks"];
+    ASSERT_EQ(benchmarks.size(), 1);
+    cv::String backend_name;
+    cv::String target_name;
+    (*benchmarks.begin())["backend"] >> backend_name;
+    (*benchmarks.begin())["target"] >> target_name;
+    backend = backend_name;
+    target = target_name;
+}
+
+
+TEST(OCVDNN, AutoBackendTest) {
+    std::string temp_dir = createTempDirectory();
+    ASSERT_FALSE(temp_dir.empty());
+    std::string benchmark_file = temp_dir + "/ocv_dnn_backend_benchmarks.json";
+
+    Properties job_props = getGoogleNetProperties();
+    job_props["DNN_BACKEND"] = "AUTO";
+    job_props["DNN_BACKEND_BENCHMARK_FILE"] = benchmark_file;
+    MPFImageJob job("Test", "data/digital-clock.jpg", job_props, {});
+
+    {
+        OcvDnnDetection ocv_dnn_component;
+        ocv_dnn_component.SetRunDirectory("../plugin");
+        ASSERT_TRUE(ocv_dnn_component.Init());
+
+        std::vector<MPFImageLocation> image_locations = ocv_dnn_component.GetDetections(job);
+        ASSERT_TRUE(containsObject("digital clock", image_locations));
+
+        ASSERT_TRUE(ocv_dnn_component.Close());
+    }
+
+    std::string first_contents = readFile(benchmark_file);
+    ASSERT_FALSE(first_contents.empty());
+    struct stat first_stat {};
+    ASSERT_EQ(stat(benchmark_file.c_str(), &first_stat), 0);
+
+    std::string first_backend;
+    std::string first_target;
+    getSavedBackend(benchmark_file, first_backend, first_target);
+    ASSERT_FALSE(first_backend.empty());
+    ASSERT_FALSE(first_target.empty());
+
+    {
+        // Uses the results saved by the previous component instance.
+        OcvDnnDetection ocv_dnn_component;
+        ocv_dnn_component.SetRunDirectory("../plugin");
+        ASSERT_TRUE(ocv_dnn_component.Init());
+
+        std::vector<MPFImageLocation> image_locations = ocv_dnn_component.GetDetections(job);
+        ASSERT_TRUE(containsObject("digital clock", image_locations));
+
+        ASSERT_TRUE(ocv_dnn_component.Close());
+    }
+
+    // The file is replaced by a rename when it is saved, so an unchanged inode means the benchmark did not run again.
+    struct stat second_stat {};
+    ASSERT_EQ(stat(benchmark_file.c_str(), &second_stat), 0);
+    ASSERT_EQ(first_stat.st_ino, second_stat.st_ino);
+    ASSERT_EQ(first_contents, readFile(benchmark_file));
+
+    std::string second_backend;
+    std::string second_target;
+    getSavedBackend(benchmark_file, second_backend, second_target);
+    ASSERT_EQ(first_backend, second_backend);
+    ASSERT_EQ(first_target, second_target);
+
+    std::remove(benchmark_file.c_str());
+    rmdir(temp_dir.c_str());
+}
+
+
+TEST(OCVDNN, InvalidBackendTest) {
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    Properties job_props = getGoogleNetProperties();
+    job_props["DNN_BACKEND"] = "NOT_A_BACKEND";
+    MPFImageJob job("Test", "data/digital-clock.jpg", job_props, {});
+
+    try {
+        ocv_dnn_component.GetDetections(job);
+        FAIL() << "Expected MPFDetectionException to be thrown.";
+    }
+    catch (const MPFDetectionException &ex) {
+        ASSERT_EQ(ex.error_code, MPF_INVALID_PROPERTY);
+    }
+
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
+
 TEST(OCVDNN, GoogleNetSpectralHashTest) {
     OcvDnnDetection ocv_dnn_component;
     ocv_dnn_component.SetRunDirectory("../plugin");
@@ -179,6 +480,114 @@ TEST(OCVDNN, GoogleNetSpectralHashTest) {
 }
 
 
+TEST(OCVDNN, SpectralHashIndexTest) {
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    std::string temp_dir = createTempDirectory();
+    ASSERT_FALSE(temp_dir.empty());
+    std::string index_file = temp_dir + "/spectral_hash_index.txt";
+
+    Properties job_props = getGoogleNetProperties();
+    job_props["SPECTRAL_HASH_FILE_LIST"] = "../plugin/OcvDnnDetection/models/bvlc_googlenet_spectral_hash.json";
+    job_props["SPECTRAL_HASH_INDEX_FILE"] = index_file;
+    job_props["SPECTRAL_HASH_MAX_NEIGHBOR_DISTANCE"] = "-1";
+
+    auto get_detection_props = [&](const std::string &image_path) {
+        MPFImageJob job("Test", image_path, job_props, {});
+        std::vector<MPFImageLocation> image_locations = ocv_dnn_component.GetDetections(job);
+        EXPECT_EQ(image_locations.size(), 1);
+        return image_locations.empty() ? Properties() : image_locations.front().detection_properties;
+    };
+
+    Properties sundial_props = get_detection_props("data/sundial.jpg");
+    ASSERT_EQ(sundial_props["LOSS3/CLASSIFIER SPECTRAL HASH NEIGHBOR LIST"], "");
+
+    Properties clock_props = get_detection_props("data/digital-clock.jpg");
+    ASSERT_EQ(clock_props["LOSS3/CLASSIFIER SPECTRAL HASH NEIGHBOR LIST"], "data/sundial.jpg");
+
+    const std::string &sundial_hash = sundial_props["LOSS3/CLASSIFIER SPECTRAL HASH VALUE"];
+    const std::string &clock_hash = clock_props["LOSS3/CLASSIFIER SPECTRAL HASH VALUE"];
+    ASSERT_EQ(sundial_hash.size(), clock_hash.size());
+    int expected_distance = 0;
+    for (int i = 0; i < sundial_hash.size(); i++) {
+        expected_distance += sundial_hash[i] != clock_hash[i];
+    }
+    ASSERT_EQ(clock_props["LOSS3/CLASSIFIER SPECTRAL HASH NEIGHBOR DISTANCE LIST"],
+              std::to_string(expected_distance));
+
+    // A detection is not reported as its own neighbor.
+    Properties sundial_props2 = get_detection_props("data/sundial.jpg");
+    ASSERT_EQ(sundial_props2["LOSS3/CLASSIFIER SPECTRAL HASH NEIGHBOR LIST"], "data/digital-clock.jpg");
+
+    // With a distance limit, the search only compares the hashes that share a nearby 16-bit chunk.
+    job_props["SPECTRAL_HASH_MAX_NEIGHBOR_DISTANCE"] = std::to_string(expected_distance - 1);
+    Properties clock_props2 = get_detection_props("data/digital-clock.jpg");
+    ASSERT_EQ(clock_props2["LOSS3/CLASSIFIER SPECTRAL HASH NEIGHBOR LIST"], "");
+
+    job_props["SPECTRAL_HASH_MAX_NEIGHBOR_DISTANCE"] = std::to_string(expected_distance);
+    Properties clock_props3 = get_detection_props("data/digital-clock.jpg");
+    ASSERT_EQ(clock_props3["LOSS3/CLASSIFIER SPECTRAL HASH NEIGHBOR LIST"], "data/sundial.jpg");
+
+    ASSERT_TRUE(ocv_dnn_component.Close());
+    std::remove(index_file.c_str());
+    rmdir(temp_dir.c_str());
+}
+
+
+TEST(OCVDNN, BinaryActivationOutputTest) {
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    Properties job_props = getGoogleNetProperties();
+    job_props["ACTIVATION_LAYER_LIST"] = "loss3/classifier";
+    job_props["ACTIVATION_OUTPUT_FORMAT"] = "BASE64";
+
+    {
+        MPFImageJob job("Test", "data/sundial.jpg", job_props, {});
+        std::vector<MPFImageLocation> image_locations = ocv_dnn_component.GetDetections(job);
+        ASSERT_EQ(image_locations.size(), 1);
+
+        std::string activation = image_locations.front().detection_properties["LOSS3/CLASSIFIER ACTIVATION MATRIX"];
+        std::string header = "float32:1x1000:";
+        ASSERT_EQ(activation.substr(0, header.size()), header);
+        // 1000 floats * 4 bytes, base64 encoded.
+        ASSERT_EQ(activation.size() - header.size(), 5336);
+    }
+
+    std::string temp_dir = createTempDirectory();
+    ASSERT_FALSE(temp_dir.empty());
+    // The component creates the output directory when it does not exist.
+    std::string output_dir = temp_dir + "/activations";
+
+    job_props["ACTIVATION_OUTPUT_FORMAT"] = "FILE";
+    job_props["ACTIVATION_OUTPUT_PRECISION"] = "FLOAT16";
+    job_props["ACTIVATION_OUTPUT_DIRECTORY"] = output_dir;
+    {
+        MPFImageJob job("Test", "data/sundial.jpg", job_props, {});
+        std::vector<MPFImageLocation> image_locations = ocv_dnn_component.GetDetections(job);
+        ASSERT_EQ(image_locations.size(), 1);
+
+        std::string activation = image_locations.front().detection_properties["LOSS3/CLASSIFIER ACTIVATION MATRIX"];
+        std::string header = "float16:1x1000:0:";
+        ASSERT_EQ(activation.substr(0, header.size()), header);
+
+        std::string file_path = activation.substr(header.size());
+        std::ifstream activation_file(file_path, std::ios::binary | std::ios::ate);
+        EXPECT_TRUE(activation_file.good());
+        EXPECT_EQ(static_cast<long>(activation_file.tellg()), 2000);
+        activation_file.close();
+        std::remove(file_path.c_str());
+    }
+
+    rmdir(output_dir.c_str());
+    rmdir(temp_dir.c_str());
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
+
 void assertVehicleColorDetectedInImage(const std::string &expected_color,
                                        const std::string &image_path,
                                        OcvDnnDetection &ocv_dnn_component) {
@@ -206,6 +615,22 @@ TEST(OCVDNN, VehicleColorImageTest) {
     ASSERT_TRUE(ocv_dnn_component.Close());
 }
 
+TEST(OCVDNN, AlternatingModelsTest) {
+
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    // The networks loaded by the first two jobs are reused by the last two jobs.
+    ASSERT_NO_FATAL_FAILURE(assertObjectDetectedInImage("digital clock", "data/digital-clock.jpg", ocv_dnn_component));
+    ASSERT_NO_FATAL_FAILURE(assertVehicleColorDetectedInImage("blue", "data/blue-car.jpg", ocv_dnn_component));
+    ASSERT_NO_FATAL_FAILURE(assertObjectDetectedInImage("sundial", "data/sundial.jpg", ocv_dnn_component));
+    ASSERT_NO_FATAL_FAILURE(assertVehicleColorDetectedInImage("red", "data/red-car.jpg", ocv_dnn_component));
+
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
 TEST(OCVDNN, FeedForwardImageTest) {
 
     OcvDnnDetection ocv_dnn_component;
@@ -356,4 +781,172 @@ TEST(OCVDNN, FeedForwardVideoTest) {
     }
 
     ASSERT_TRUE(ocv_dnn_component.Close());
-}
\ No newline at end of file
+}
+
+TEST(OCVDNN, FeedForwardClassificationIntervalTest) {
+
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    int end_frame = 4;
+    std::string video_path = "data/lp-ferrari-texas-shortened.mp4";
+
+    MPFVideoTrack vehicle_track = {0, end_frame, 0.4, {{"CLASSIFICATION", "car"}}};
+    for (int i = 0; i <= end_frame; i++) {
+        vehicle_track.frame_locations[i] = {10, 20, 100, 200, 0.5, {{"CLASSIFICATION", "car"}}};
+    }
+
+    Properties props = getVehicleColorProperties();
+    props["CLASSIFICATION_TYPE"] = "COLOR";
+    props["FEED_FORWARD_TYPE"] = "FRAME";
+    props["FEED_FORWARD_CLASSIFICATION_INTERVAL"] = "2";
+    props["BATCH_SIZE"] = "2";
+
+    MPFVideoJob job("Test", video_path, 0, end_frame, props, {});
+    job.feed_forward_track = vehicle_track;
+    job.has_feed_forward_track = true;
+
+    std::vector<MPFVideoTrack> tracks = ocv_dnn_component.GetDetections(job);
+
+    ASSERT_EQ(1, tracks.size());
+    MPFVideoTrack &track = tracks.at(0);
+    ASSERT_EQ("red", track.detection_properties.at("COLOR"));
+
+    // Frames that were not classified reuse the detection from the previous classified frame.
+    ASSERT_EQ(end_frame + 1, track.frame_locations.size());
+    for (int i = 1; i <= end_frame; i += 2) {
+        ASSERT_EQ(track.frame_locations.at(i - 1).detection_properties.at("COLOR LIST"),
+                  track.frame_locations.at(i).detection_properties.at("COLOR LIST"));
+    }
+
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
+
+// Writes a video with one frame for each image, resized to the same frame size.
+void writeTestVideo(const std::string &video_path, const std::vector<std::string> &image_paths) {
+    cv::Size frame_size(640, 480);
+    cv::VideoWriter writer(video_path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 10, frame_size);
+    ASSERT_TRUE(writer.isOpened());
+    for (const std::string &image_path : image_paths) {
+        cv::Mat image = cv::imread(image_path);
+        ASSERT_FALSE(image.empty());
+        cv::Mat frame;
+        cv::resize(image, frame, frame_size);
+        writer.write(frame);
+    }
+}
+
+
+void runClassificationIntervalJob(OcvDnnDetection &ocv_dnn_component, const std::string &video_path,
+                                  int end_frame, MPFVideoTrack &track) {
+    MPFVideoTrack feed_forward_track(0, end_frame);
+    for (int i = 0; i <= end_frame; i++) {
+        feed_forward_track.frame_locations[i] = { 0, 0, 640, 480 };
+    }
+
+    Properties props = getGoogleNetProperties();
+    props["FEED_FORWARD_TYPE"] = "FRAME";
+    props["FEED_FORWARD_CLASSIFICATION_INTERVAL"] = "2";
+
+    MPFVideoJob job("Test", video_path, 0, end_frame, props, {});
+    job.feed_forward_track = feed_forward_track;
+    job.has_feed_forward_track = true;
+
+    std::vector<MPFVideoTrack> tracks = ocv_dnn_component.GetDetections(job);
+    ASSERT_EQ(1, tracks.size());
+    track = tracks.front();
+    ASSERT_EQ(end_frame + 1, track.frame_locations.size());
+}
+
+
+TEST(OCVDNN, FeedForwardMajorityVoteTest) {
+    OcvDnnDetection ocv_dnn_component;
+    ocv_dnn_component.SetRunDirectory("../plugin");
+    ASSERT_TRUE(ocv_dnn_component.Init());
+
+    std::string temp_dir = createTempDirectory();
+    ASSERT_FALSE(temp_dir.empty());
+    std::string video_path = temp_dir + "/majority-vote.avi";
+
+    // With an interval of 2, frames 0, 2, and 4 are classified and each following frame reuses their
+    // detection, so "digital clock" gets 2 votes and "sundial" gets 4.
+    ASSERT_NO_FATAL_FAILURE(writeTestVideo(video_path, {
+            "data/digital-clock.jpg", "data/digital-clock.jpg",
+            "data/sundial.jpg", "data/sundial.jpg", "data/sundial.jpg", "data/sundial.jpg" }));
+    MPFVideoTrack track;
+    ASSERT_NO_FATAL_FAILURE(runClassificationIntervalJob(ocv_dnn_component, video_path, 5, track));
+    ASSERT_EQ("digital clock", track.frame_locations.at(0).detection_properties.at("CLASSIFICATION"));
+    ASSERT_EQ("digital clock", track.frame_locations.at(1).detection_properties.at("CLASSIFICATION"));
+    for (int i = 2; i <= 5; i++) {
+        ASSERT_EQ("sundial", track.frame_locations.at(i).detection_properties.at("CLASSIFICATION"));
+    }
+    ASSERT_EQ("sundial", track.detection_properties.at("CLASSIFICATION"));
+    float max_sundial_confidence = 0;
+    for (int i = 2; i <= 5; i++) {
+        max_sundial_confidence = std::max(max_sundial_confidence, track.frame_locations.at(i).confidence);
+    }
+    ASSERT_FLOAT_EQ(max_sundial_confidence, track.confidence);
+
+    // Each classification gets 2 votes, so the tie goes to the one with the highest detection confidence.
+    ASSERT_NO_FATAL_FAILURE(writeTestVideo(video_path, {
+            "data/digital-clock.jpg", "data/digital-clock.jpg", "data/sundial.jpg", "data/sundial.jpg" }));
+    ASSERT_NO_FATAL_FAILURE(runClassificationIntervalJob(ocv_dnn_component, video_path, 3, track));
+    ASSERT_EQ("digital clock", track.frame_locations.at(0).detection_properties.at("CLASSIFICATION"));
+    ASSERT_EQ("sundial", track.frame_locations.at(2).detection_properties.at("CLASSIFICATION"));
+    float clock_confidence = track.frame_locations.at(0).confidence;
+    float sundial_confidence = track.frame_locations.at(2).confidence;
+    ASSERT_NE(clock_confidence, sundial_confidence);
+    std::string expected_winner = clock_confidence > sundial_confidence ? "digital clock" : "sundial";
+    ASSERT_EQ(expected_winner, track.detection_properties.at("CLASSIFICATION"));
+    ASSERT_FLOAT_EQ(std::max(clock_confidence, sundial_confidence), track.confidence);
+
+    std::remove(video_path.c_str());
+    rmdir(temp_dir.c_str());
+    ASSERT_TRUE(ocv_dnn_component.Close());
+}
+
+
+TEST(OcvDnnStreaming, VideoTest) {
+    int end_frame = 4;
+    Properties job_props = getGoogleNetProperties();
+    job_props["BATCH_SIZE"] = "2";
+    job_props["STREAMING_FRAME_INTERVAL"] = "2";
+    MPFStreamingVideoJob job("Test", "../plugin/", job_props, {});
+    OcvDnnStreamingDetection component(job);
+    int frame_number = 0;
+
+    // The same frames are processed in both segments, so the same results should be found in both segments.
+    for (int segment = 0; segment < 2; segment++) {
+        VideoSegmentInfo segment_info(segment, frame_number, frame_number + end_frame, 100, 100);
+        component.BeginSegment(segment_info);
+
+        MPFVideoCapture cap({"Test", "data/lp-ferrari-texas-shortened.mp4", 0, end_frame, {}, {}});
+
+        int true_count = 0;
+        cv::Mat frame;
+        while (cap.Read(frame)) {
+            if (component.ProcessFrame(frame, frame_number)) {
+                true_count++;
+            }
+            frame_number++;
+        }
+
+        std::vector<MPFVideoTrack> tracks = component.EndSegment();
+        ASSERT_FALSE(tracks.empty());
+        // Partial batches are run at the end of the segment, so the detection is reported by the last frame.
+        ASSERT_EQ(1, true_count);
+
+        // Only every other frame is classified.
+        std::vector<int> classified_frames;
+        for (const MPFVideoTrack &track : tracks) {
+            for (const auto &frame_location : track.frame_locations) {
+                classified_frames.push_back(frame_location.first);
+            }
+        }
+        int start = segment_info.start_frame;
+        ASSERT_EQ(std::vector<int>({ start, start + 2, start + 4 }), classified_frames);
+    }
+}
@@ -69,9 +69,13 @@
 ////////////////////////////////////////////////////////////////////////////////////////
 
 
+#include <fstream>
+
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include <MPFDetectionException.h>
+
 #include "OcvDetection.h"
 
 
@@ -84,30 +88,143 @@ using cv::saturate_cast;
 using cv::SimilarRects;
 using cv::Size;
 
+using MPF::COMPONENT::MPFDetectionException;
+using MPF::COMPONENT::MPF_COULD_NOT_READ_DATAFILE;
+
 OcvDetection::OcvDetection() {
     initialized = false;
+    dnn_initialized = false;
 
     //trained lbp cascade
     face_cascade_path = "/data/cascade.xml";
+
+    //res10 ssd face model
+    dnn_face_model_path = "/data/res10_300x300_ssd_iter_140000.caffemodel";
+    dnn_face_config_path = "/data/deploy.prototxt";
 }
 
 OcvDetection::~OcvDetection() { }
 
 bool OcvDetection::Init(std::string &plugin_path) {
     openFaceDetectionLogger = log4cxx::Logger::getLogger("OcvFaceDetection");
+    this->plugin_path = plugin_path;
 
-    //Load cascades
-    std::string cascade_path = plugin_path + face_cascade_path;
-    if( !face_cascade.load(cascade_path) ) {
-        LOG4CXX_ERROR(openFaceDetectionLogger, "Issue loading: " << cascade_path);
+    //Load cascades - the first cascade is loaded here to make sure the file is valid, and is then used by the
+    //first job
+    std::unique_ptr<cv::CascadeClassifier> face_cascade = LoadCascade();
+    if (!face_cascade) {
         return false;
     }
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        available_cascades.clear();
+        available_dnn_nets.clear();
+        available_cascades.push_back(std::move(face_cascade));
+    }
 
     initialized = true;
 
+    //the dnn model is optional - only jobs that ask for the dnn detector need it
+    std::string dnn_model_path = plugin_path + dnn_face_model_path;
+    std::string dnn_config_path = plugin_path + dnn_face_config_path;
+    if (!std::ifstream(dnn_model_path).good() || !std::ifstream(dnn_config_path).good()) {
+        LOG4CXX_WARN(openFaceDetectionLogger, "DNN face model not found at: " << dnn_model_path
+                                              << " - only the cascade detector can be used");
+        return true;
+    }
+
+    std::unique_ptr<cv::dnn::Net> dnn_face_net = LoadDnnNet();
+    dnn_initialized = dnn_face_net != nullptr;
+    if (dnn_initialized) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        available_dnn_nets.push_back(std::move(dnn_face_net));
+    }
+
     return true;
 }
 
+std::unique_ptr<cv::CascadeClassifier> OcvDetection::LoadCascade() {
+    std::string cascade_path = plugin_path + face_cascade_path;
+    std::unique_ptr<cv::CascadeClassifier> face_cascade(new cv::CascadeClassifier());
+    if( !face_cascade->load(cascade_path) ) {
+        LOG4CXX_ERROR(openFaceDetectionLogger, "Issue loading: " << cascade_path);
+        return nullptr;
+    }
+    return face_cascade;
+}
+
+std::unique_ptr<cv::dnn::Net> OcvDetection::LoadDnnNet() {
+    std::string dnn_model_path = plugin_path + dnn_face_model_path;
+    std::string dnn_config_path = plugin_path + dnn_face_config_path;
+    try {
+        std::unique_ptr<cv::dnn::Net> dnn_face_net(
+                new cv::dnn::Net(cv::dnn::readNetFromCaffe(dnn_config_path, dnn_model_path)));
+        dnn_face_net->setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        dnn_face_net->setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        if (!dnn_face_net->empty()) {
+            return dnn_face_net;
+        }
+        LOG4CXX_WARN(openFaceDetectionLogger, "Issue loading: " << dnn_model_path << ": the net is empty");
+    }
+    catch (const cv::Exception &ex) {
+        LOG4CXX_WARN(openFaceDetectionLogger, "Issue loading: " << dnn_model_path << ": " << ex.what());
+    }
+    return nullptr;
+}
+
+OcvDetection::CascadePtr OcvDetection::CheckoutCascade() {
+    std::unique_ptr<cv::CascadeClassifier> face_cascade;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (!available_cascades.empty()) {
+            face_cascade = std::move(available_cascades.back());
+            available_cascades.pop_back();
+        }
+    }
+
+    //every cascade is checked out by another job, so this job loads its own
+    if (!face_cascade) {
+        face_cascade = LoadCascade();
+        if (!face_cascade) {
+            throw MPFDetectionException(MPF_COULD_NOT_READ_DATAFILE,
+                                        "Failed to load the face cascade from: " + plugin_path + face_cascade_path);
+        }
+    }
+
+    return CascadePtr(face_cascade.release(), [this](cv::CascadeClassifier *returned_cascade) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        available_cascades.emplace_back(returned_cascade);
+    });
+}
+
+OcvDetection::DnnNetPtr OcvDetection::CheckoutDnnNet() {
+    std::unique_ptr<cv::dnn::Net> dnn_face_net;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (!available_dnn_nets.empty()) {
+            dnn_face_net = std::move(available_dnn_nets.back());
+            available_dnn_nets.pop_back();
+        }
+    }
+
+    if (!dnn_face_net && dnn_initialized) {
+        dnn_face_net = LoadDnnNet();
+    }
+    if (!dnn_face_net) {
+        throw MPFDetectionException(MPF_COULD_NOT_READ_DATAFILE,
+                                    "Failed to load the DNN face model from: " + plugin_path + dnn_face_model_path);
+    }
+
+    return DnnNetPtr(dnn_face_net.release(), [this](cv::dnn::Net *returned_net) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        available_dnn_nets.emplace_back(returned_net);
+    });
+}
+
+bool OcvDetection::IsDnnInitialized() const {
+    return dnn_initialized;
+}
+
 /*This method clusters all the input rectangles (rectList) using the rectangle equivalence criteria that
 combines rectangles with similar sizes and similar locations. */
 void OcvDetection::GroupRectanglesMod(vector<Rect>& rectList, int groupThreshold, double eps,
@@ -212,7 +329,8 @@ void OcvDetection::GroupRectanglesMod(vector<Rect>& rectList, int groupThreshold
     }
 }
 
-vector<pair<Rect, int>> OcvDetection::DetectFaces(const Mat &frame_gray, int min_face_size) {
+vector<pair<Rect, int>> OcvDetection::DetectFaces(cv::CascadeClassifier &face_cascade, const Mat &frame_gray,
+                                                  int min_face_size, int max_frame_dimension) {
     std::vector<Rect> faces;
     std::vector<Rect> weighted_faces;
     std::vector<pair<Rect, int>> face_confidence_pairs;
@@ -222,7 +340,22 @@ vector<pair<Rect, int>> OcvDetection::DetectFaces(const Mat &frame_gray, int min
         return face_confidence_pairs;
     }
 
-    Mat frame_gray_clone = frame_gray.clone();
+    //if the frame is larger than the max dimension the detection is done on a downscaled frame and the detected
+    //rects are scaled back up - faces smaller than the detection window at the downscaled size will be missed
+    double scale = 1.0;
+    int frame_dimension = std::max(frame_gray.cols, frame_gray.rows);
+    if (max_frame_dimension > 0 && frame_dimension > max_frame_dimension) {
+        scale = static_cast<double>(max_frame_dimension) / static_cast<double>(frame_dimension);
+    }
+
+    Mat frame_gray_clone;
+    if (scale < 1.0) {
+        resize(frame_gray, frame_gray_clone, Size(), scale, scale, cv::INTER_AREA);
+        min_face_size = std::max(1, cvRound(min_face_size * scale));
+    }
+    else {
+        frame_gray_clone = frame_gray.clone();
+    }
     equalizeHist( frame_gray_clone, frame_gray_clone);
 
     vector<int> reject_levels;
@@ -292,6 +425,12 @@ vector<pair<Rect, int>> OcvDetection::DetectFaces(const Mat &frame_gray, int min
 //			}
 
             if(found_rect.area() > 0) {
+                if (scale < 1.0) {
+                    found_rect = Rect(cvRound(found_rect.x / scale),
+                                      cvRound(found_rect.y / scale),
+                                      cvRound(found_rect.width / scale),
+                                      cvRound(found_rect.height / scale));
+                }
                 int reject_level = reject_levels[i];
                 pair<Rect, int> p(found_rect, reject_level);
                 face_confidence_pairs.push_back(p);
@@ -301,3 +440,54 @@ vector<pair<Rect, int>> OcvDetection::DetectFaces(const Mat &frame_gray, int min
 
     return face_confidence_pairs;
 }
+
+vector<pair<Rect, int>> OcvDetection::DetectFacesDnn(cv::dnn::Net &face_net, const Mat &frame, int min_face_size,
+                                                     int input_size, float min_confidence) {
+    vector<pair<Rect, int>> face_confidence_pairs;
+
+    if(!dnn_initialized) {
+        LOG4CXX_ERROR(openFaceDetectionLogger, "Ocv dnn detection is not initialized and cannot detect faces. Please check previous errors.");
+        return face_confidence_pairs;
+    }
+
+    //the model was trained on bgr images
+    Mat frame_bgr;
+    if (frame.channels() == 1) {
+        cvtColor(frame, frame_bgr, cv::COLOR_GRAY2BGR);
+    }
+    else {
+        frame_bgr = frame;
+    }
+
+    //the largest frame dimension is scaled to input_size and the aspect ratio is kept - the ssd output is
+    //normalized to the input size, so no scaling back is needed
+    double scale = static_cast<double>(input_size) / std::max(frame_bgr.cols, frame_bgr.rows);
+    Size blob_size(std::max(1, cvRound(frame_bgr.cols * scale)), std::max(1, cvRound(frame_bgr.rows * scale)));
+    Mat blob = cv::dnn::blobFromImage(frame_bgr, 1.0, blob_size, cv::Scalar(104.0, 177.0, 123.0), false, false);
+
+    face_net.setInput(blob);
+    Mat output = face_net.forward();
+
+    //each row of the output is [image id, class id, confidence, left, top, right, bottom]
+    Mat detections(output.size[2], output.size[3], CV_32F, output.ptr<float>());
+    Rect frame_rect(0, 0, frame.cols, frame.rows);
+    for (int i = 0; i < detections.rows; i++) {
+        float confidence = detections.at<float>(i, 2);
+        if (confidence < min_confidence) {
+            continue;
+        }
+
+        cv::Point top_left(cvRound(detections.at<float>(i, 3) * frame.cols),
+                           cvRound(detections.at<float>(i, 4) * frame.rows));
+        cv::Point bottom_right(cvRound(detections.at<float>(i, 5) * frame.cols),
+                               cvRound(detections.at<float>(i, 6) * frame.rows));
+        Rect face = Rect(top_left, bottom_right) & frame_rect;
+        if (face.width < min_face_size || face.height < min_face_size) {
+            continue;
+        }
+
+        face_confidence_pairs.push_back(pair<Rect, int>(face, cvRound(confidence * 100.0f)));
+    }
+
+    return face_confidence_pairs;
+}
@@ -28,6 +28,9 @@
 #ifndef OPENMPF_COMPONENTS_OCVDETECTION_H
 #define OPENMPF_COMPONENTS_OCVDETECTION_H
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <utility>
@@ -35,26 +38,59 @@
 #include <log4cxx/logger.h>
 
 #include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
 #include <opencv2/objdetect.hpp>
 
 class OcvDetection {
 public:
+    //the cascade and the net keep per-image state while detecting, so each job checks out its own copy - the copy
+    //goes back to the pool when the pointer is destroyed, so the files are only loaded again when more jobs than
+    //ever before are running at the same time
+    using CascadePtr = std::unique_ptr<cv::CascadeClassifier, std::function<void(cv::CascadeClassifier*)>>;
+    using DnnNetPtr = std::unique_ptr<cv::dnn::Net, std::function<void(cv::dnn::Net*)>>;
+
     OcvDetection();
     virtual ~OcvDetection();
 
-    std::vector<std::pair<cv::Rect, int>> DetectFaces(const cv::Mat &frame_gray, int min_face_size = 48);
+    //the pointers must be destroyed before this object - throws if the file can not be loaded
+    CascadePtr CheckoutCascade();
+    DnnNetPtr CheckoutDnnNet();
+
+    std::vector<std::pair<cv::Rect, int>> DetectFaces(cv::CascadeClassifier &face_cascade, const cv::Mat &frame_gray,
+                                                      int min_face_size = 48, int max_frame_dimension = 0);
+
+    //the confidence of a dnn face is its detection score as a percentage so it can be compared with the
+    //MIN_INITIAL_CONFIDENCE setting used for the cascade
+    std::vector<std::pair<cv::Rect, int>> DetectFacesDnn(cv::dnn::Net &face_net, const cv::Mat &frame,
+                                                         int min_face_size = 48, int input_size = 300,
+                                                         float min_confidence = 0.5f);
+
+    bool IsDnnInitialized() const;
 
     bool Init(std::string &run_directory);
 
 private:
     std::string face_cascade_path;
 
-    cv::CascadeClassifier face_cascade;
+    std::string dnn_face_model_path;
+    std::string dnn_face_config_path;
+
+    std::string plugin_path;
+
+    //the loaded cascades and nets that are not checked out by a job
+    std::vector<std::unique_ptr<cv::CascadeClassifier>> available_cascades;
+    std::vector<std::unique_ptr<cv::dnn::Net>> available_dnn_nets;
+    std::mutex pool_mutex;
 
     bool initialized;
+    bool dnn_initialized;
 
     log4cxx::LoggerPtr openFaceDetectionLogger;
 
+    //returns nullptr if the file can not be loaded
+    std::unique_ptr<cv::CascadeClassifier> LoadCascade();
+    std::unique_ptr<cv::dnn::Net> LoadDnnNet();
+
     void GroupRectanglesMod(std::vector<cv::Rect>& rectList, int groupThreshold, double eps, std::vector<int>* weights, std::vector<double>* levelWeights);
 };
 
@@ -28,16 +28,10 @@
 #ifndef OPENMPF_COMPONENTS_OCVFACEDETECTION_H
 #define OPENMPF_COMPONENTS_OCVFACEDETECTION_H
 
-#include <map>
 #include <string>
 #include <vector>
 
-#include <QHash>
-#include <QString>
-
-#include <opencv2/features2d.hpp>
-#include <opencv2/video/tracking.hpp>
-#include <opencv2/highgui.hpp>
+#include <opencv2/core.hpp>
 
 #include <adapters/MPFImageAndVideoDetectionComponentAdapter.h>
 #include <MPFDetectionComponent.h>
@@ -46,89 +40,29 @@
 
 #include <log4cxx/logger.h>
 
-#include "OcvDetection.h"
-
-
+#include "OcvFaceTracker.h"
 
-struct Track {
-    MPF::COMPONENT::MPFVideoTrack face_track;
-    int init_point_count;
-    int current_point_count;
-    float current_point_percent;
-    int last_face_detected_index;
-    bool track_lost;
-    std::vector <cv::Point2f> previous_points;
-    std::vector <cv::Point2f> current_points;
 
-    //TODO: see if these are useful
-    cv::Mat first_gray_frame;
-    std::vector <cv::KeyPoint> previous_keypoints;
-    std::vector <cv::KeyPoint> current_keypoints;
-    std::vector <cv::KeyPoint> first_detected_keypoints;
-
-    Track() : init_point_count(0), current_point_count(0), current_point_percent(0.0), last_face_detected_index(-1),
-            track_lost(false) { }
-};
 
 class OcvFaceDetection : public MPF::COMPONENT::MPFImageAndVideoDetectionComponentAdapter {
 
 private:
-    OcvDetection ocv_detection;
-
-    int max_features;
-    cv::Ptr <cv::FeatureDetector> feature_detector;
-
-    bool imshow_on;
-    int verbosity;
-
-    int min_face_size; //the width and height of min size for detection
-    unsigned int min_init_point_count;
-    float min_redetect_point_perecent;
-    float min_point_percent;
-    float max_optical_flow_error;
-    float min_initial_confidence;
-
-    //TODO: add to config file
-    //when a face is not detected - this is the minimum percentage of features detected compared to initial point count
-    //if below this the track should not continue
-    float min_good_match_percent;
-
-    std::vector <Track> current_tracks;
-    std::vector <Track> saved_tracks;
-
-    QHash <QString, QString> parameters;
+    OcvFaceTracker tracker;
 
     log4cxx::LoggerPtr OpenFaceDetectionLogger;
 
-    void SetDefaultParameters();
-    void SetReadConfigParameters();
-    void GetPropertySettings(const std::map <std::string, std::string> &algorithm_properties);
-
-    void Display(const std::string title, const cv::Mat &img);
-
-    cv::Rect GetMatch(const cv::Mat &frame_rgb_display, const cv::Mat &frame_gray, const cv::Mat &templ);
-
-    bool IsExistingTrackIntersection(const cv::Rect new_rect, int &intersection_index);
-
-    cv::Rect GetUpscaledFaceRect(const cv::Rect &face_rect);
-    cv::Mat GetMask(const cv::Mat &frame, const cv::Rect &face, bool copy_face_rect = false);
-    bool IsBadFaceRatio(const cv::Rect &face);
-
-    void CloseAnyOpenTracks(int frame_index);
-
-    void AdjustRectToEdges(cv::Rect &rect, const cv::Mat &src);
-
     void LogDetection(const MPF::COMPONENT::MPFImageLocation& face,
                       const std::string& job_name);
 
-    void CloseWindows();
+    void CloseWindows(const OcvFaceJobContext &context);
 
     std::vector<MPF::COMPONENT::MPFVideoTrack> GetDetectionsFromVideoCapture(
+            OcvFaceJobContext &context,
             const MPF::COMPONENT::MPFVideoJob &job,
             MPF::COMPONENT::MPFVideoCapture &video_capture);
 
     std::vector<MPF::COMPONENT::MPFImageLocation> GetDetectionsFromImageData(
-            const MPF::COMPONENT::MPFImageJob &job, cv::Mat &image_data);
+            OcvFaceJobContext &context, const MPF::COMPONENT::MPFImageJob &job, cv::Mat &image_data);
 
 public :
 
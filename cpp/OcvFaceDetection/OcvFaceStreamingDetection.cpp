@@ -0,0 +1,261 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+#include "OcvFaceStreamingDetection.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <sstream>
+#include <utility>
+
+#include <log4cxx/xml/domconfigurator.h>
+
+#include <detectionComponentUtils.h>
+#include <MPFDetectionException.h>
+#include <MPFInvalidPropertyException.h>
+
+
+using namespace MPF::COMPONENT;
+
+
+namespace {
+    [[noreturn]] void LogError(const std::string &message, const log4cxx::LoggerPtr &logger) {
+        try {
+            throw;
+        }
+        catch (const std::exception &ex) {
+            LOG4CXX_ERROR(logger, message << ": " << ex.what());
+            throw;
+        }
+        catch (...) {
+            LOG4CXX_ERROR(logger, message << ".");
+            throw;
+        }
+    }
+
+
+    // Tracks that continue from the previous segment still hold the last face of that segment, which is removed
+    // before the track is reported. Tracks that have no faces left in the current segment are not reported.
+    void AddSegmentTrack(MPFVideoTrack &&track, int segment_start_frame, std::vector<MPFVideoTrack> &tracks) {
+        track.frame_locations.erase(track.frame_locations.begin(),
+                                    track.frame_locations.lower_bound(segment_start_frame));
+        if (track.frame_locations.empty()) {
+            return;
+        }
+
+        track.start_frame = track.frame_locations.begin()->first;
+        track.confidence = -1;
+        for (const auto &frame_location : track.frame_locations) {
+            track.confidence = std::max(track.confidence, frame_location.second.confidence);
+        }
+        tracks.push_back(std::move(track));
+    }
+}
+
+
+
+OcvFaceStreamingDetection::OcvFaceStreamingDetection(const MPFStreamingVideoJob &job)
+try
+        : MPFStreamingDetectionComponent(job)
+        , job_name_(job.job_name)
+        , log_prefix_("[" + job.job_name + "] ")
+        , max_detection_frame_interval_(DetectionComponentUtils::GetProperty(
+                job.job_properties, "STREAMING_MAX_DETECTION_FRAME_INTERVAL", 8))
+        , frame_period_seconds_(0)
+{
+    std::string plugin_path = job.run_directory + "/OcvFaceDetection";
+    log4cxx::xml::DOMConfigurator::configure(plugin_path + "/config/Log4cxxConfig.xml");
+    logger_ = log4cxx::Logger::getLogger("OcvFaceStreamingDetection");
+
+    if (!tracker_.Init(plugin_path)) {
+        throw MPFDetectionException(MPF_DETECTION_NOT_INITIALIZED,
+                                    "Failed to initialize the OcvFaceDetection component.");
+    }
+
+    tracker_.InitJobContext(job.job_properties, context_);
+    // There is nobody to look at debug windows during a streaming job.
+    context_.imshow_on = false;
+
+    min_detection_frame_interval_ = context_.detection_frame_interval;
+    if (max_detection_frame_interval_ < 1) {
+        throw MPFInvalidPropertyException(
+                "STREAMING_MAX_DETECTION_FRAME_INTERVAL",
+                "The value, " + std::to_string(max_detection_frame_interval_)
+                + ", is not valid. It must be greater than 0.");
+    }
+
+    double frame_rate = DetectionComponentUtils::GetProperty(
+            job.job_properties, "STREAMING_FRAME_RATE",
+            DetectionComponentUtils::GetProperty(job.media_properties, "FPS", 0.0));
+    if (frame_rate > 0) {
+        frame_period_seconds_ = 1.0 / frame_rate;
+    }
+    else if (max_detection_frame_interval_ > min_detection_frame_interval_) {
+        LOG4CXX_INFO(logger_, log_prefix_ << "The frame rate of the stream is unknown, so the detection interval "
+                                          << "will not be adjusted.");
+    }
+}
+catch (...) {
+    ::LogError("An error occurred while initializing job \"" + job.job_name + "\"",
+               log4cxx::Logger::getLogger("OcvFaceStreamingDetection"));
+}
+
+
+std::string OcvFaceStreamingDetection::GetDetectionType() {
+    return "FACE";
+}
+
+
+void OcvFaceStreamingDetection::BeginSegment(const VideoSegmentInfo &segment_info) {
+    std::ostringstream ss;
+    ss << "[" << job_name_ << ": Segment #" << segment_info.segment_number
+       << " (" << segment_info.start_frame << " - " << segment_info.end_frame << ")] ";
+    log_prefix_ = ss.str();
+
+    segment_start_frame_ = segment_info.start_frame;
+    reported_detection_in_segment_ = false;
+}
+
+
+bool OcvFaceStreamingDetection::ProcessFrame(const cv::Mat &frame, int frame_number) {
+    try {
+        auto start_time = std::chrono::steady_clock::now();
+        tracker_.TrackFrame(context_, frame, frame_number, job_name_);
+        std::chrono::duration<double> frame_seconds = std::chrono::steady_clock::now() - start_time;
+        last_frame_number_ = frame_number;
+
+        AdjustDetectionInterval(frame_seconds.count());
+
+        if (reported_detection_in_segment_ || !HasReportableTrack(frame_number)) {
+            return false;
+        }
+        LOG4CXX_INFO(logger_, log_prefix_ << "Found first face in segment in frame number: " << frame_number);
+        reported_detection_in_segment_ = true;
+        return true;
+    }
+    catch (...) {
+        LogError("An error occurred while processing frame " + std::to_string(frame_number));
+    }
+}
+
+
+std::vector<MPFVideoTrack> OcvFaceStreamingDetection::EndSegment() {
+    try {
+        std::vector<MPFVideoTrack> tracks;
+        for (Track &track : context_.saved_tracks) {
+            AddSegmentTrack(std::move(track.face_track), segment_start_frame_, tracks);
+        }
+        context_.saved_tracks.clear();
+
+        // The open tracks are reported up to the end of the segment, but their points are kept so that they can be
+        // continued in the next segment. Only the last face is kept, because it is needed to move or match the face
+        // in the next frame.
+        for (Track &track : context_.current_tracks) {
+            MPFVideoTrack segment_track = std::move(track.face_track);
+            segment_track.stop_frame = last_frame_number_;
+
+            track.face_track = MPFVideoTrack();
+            track.face_track.start_frame = segment_track.start_frame;
+            const auto &last_face = *segment_track.frame_locations.rbegin();
+            track.face_track.frame_locations.insert(last_face);
+            track.face_track.confidence = last_face.second.confidence;
+
+            AddSegmentTrack(std::move(segment_track), segment_start_frame_, tracks);
+        }
+
+        LOG4CXX_INFO(logger_, log_prefix_ << "End segment. " << tracks.size() << " tracks reported. "
+                                          << context_.current_tracks.size() << " tracks continue into the next "
+                                          << "segment.");
+        return tracks;
+    }
+    catch (...) {
+        LogError("An error occurred while generating tracks for segment");
+    }
+}
+
+
+bool OcvFaceStreamingDetection::HasReportableTrack(int frame_number) const {
+    // Tracks lost within two frames of their start are discarded by TrackFrame, so an open track is only counted once
+    // it would be kept. Every open track has a face in the current frame.
+    for (const Track &track : context_.current_tracks) {
+        if (frame_number - track.face_track.start_frame > 1) {
+            return true;
+        }
+    }
+    // Tracks carried over from the previous segment may have been lost before they had a face in this segment.
+    for (const Track &track : context_.saved_tracks) {
+        if (track.face_track.stop_frame >= segment_start_frame_) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void OcvFaceStreamingDetection::AdjustDetectionInterval(double frame_seconds) {
+    if (frame_period_seconds_ <= 0 || max_detection_frame_interval_ <= min_detection_frame_interval_) {
+        return;
+    }
+
+    average_frame_seconds_ = average_frame_seconds_ == 0
+                             ? frame_seconds
+                             : 0.9 * average_frame_seconds_ + 0.1 * frame_seconds;
+
+    // Detection is the expensive part of a frame, so the average only reflects a new interval after a few frames
+    // with detection.
+    ++frames_since_interval_change_;
+    int &interval = context_.detection_frame_interval;
+    if (frames_since_interval_change_ < 2 * interval) {
+        return;
+    }
+
+    if (average_frame_seconds_ > frame_period_seconds_ && interval < max_detection_frame_interval_) {
+        interval = std::min(max_detection_frame_interval_, interval * 2);
+    }
+    // Halving the interval at most doubles the time spent on detection, so it is only lowered once frames take less
+    // than half of the time between frames.
+    else if (average_frame_seconds_ < 0.5 * frame_period_seconds_ && interval > min_detection_frame_interval_) {
+        interval = std::max(min_detection_frame_interval_, interval / 2);
+    }
+    else {
+        return;
+    }
+
+    LOG4CXX_INFO(logger_, log_prefix_ << "Average frame processing time is " << average_frame_seconds_ * 1000
+                                      << " ms for a frame period of " << frame_period_seconds_ * 1000
+                                      << " ms. Faces will now be detected every " << interval << " frames.");
+    frames_since_interval_change_ = 0;
+}
+
+
+void OcvFaceStreamingDetection::LogError(const std::string &message) {
+    ::LogError(log_prefix_ + message, logger_);
+}
+
+
+EXPORT_MPF_STREAMING_COMPONENT(OcvFaceStreamingDetection);
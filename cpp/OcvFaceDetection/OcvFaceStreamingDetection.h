@@ -0,0 +1,99 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+#ifndef OPENMPF_COMPONENTS_OCVFACESTREAMINGDETECTION_H
+#define OPENMPF_COMPONENTS_OCVFACESTREAMINGDETECTION_H
+
+#include <string>
+#include <vector>
+
+#include <log4cxx/logger.h>
+
+#include <MPFDetectionObjects.h>
+#include <MPFStreamingDetectionComponent.h>
+
+#include "OcvFaceTracker.h"
+
+
+class OcvFaceStreamingDetection : public MPF::COMPONENT::MPFStreamingDetectionComponent {
+
+public:
+    explicit OcvFaceStreamingDetection(const MPF::COMPONENT::MPFStreamingVideoJob &job);
+
+    std::string GetDetectionType() override;
+
+    void BeginSegment(const MPF::COMPONENT::VideoSegmentInfo &segment_info) override;
+
+    bool ProcessFrame(const cv::Mat &frame, int frame_number) override;
+
+    std::vector<MPF::COMPONENT::MPFVideoTrack> EndSegment() override;
+
+private:
+    log4cxx::LoggerPtr logger_;
+
+    std::string job_name_;
+
+    std::string log_prefix_;
+
+    // Owns the face detectors, which stay loaded for the lifetime of the job. It must be declared before context_,
+    // because the context returns its checked out detector to the tracker when it is destroyed.
+    OcvFaceTracker tracker_;
+
+    // The settings and the open tracks. The open tracks are carried from one segment to the next.
+    OcvFaceJobContext context_;
+
+    int segment_start_frame_ = 0;
+
+    int last_frame_number_ = -1;
+
+    bool reported_detection_in_segment_ = false;
+
+    // The detection interval is raised when frames take longer to process than the time between frames, and lowered
+    // again when processing catches up. It stays between the job's DETECTION_FRAME_INTERVAL and
+    // STREAMING_MAX_DETECTION_FRAME_INTERVAL.
+    int min_detection_frame_interval_;
+
+    int max_detection_frame_interval_;
+
+    // 0 when the frame rate of the stream is unknown, which disables the adjustment.
+    double frame_period_seconds_;
+
+    double average_frame_seconds_ = 0;
+
+    int frames_since_interval_change_ = 0;
+
+    // Whether a track that will be reported at the end of the segment has a face in the current frame or an earlier
+    // frame of the segment.
+    bool HasReportableTrack(int frame_number) const;
+
+    void AdjustDetectionInterval(double frame_seconds);
+
+    [[noreturn]] void LogError(const std::string &message);
+};
+
+
+#endif //OPENMPF_COMPONENTS_OCVFACESTREAMINGDETECTION_H
@@ -0,0 +1,1109 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+#include "OcvFaceTracker.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include <MPFDetectionException.h>
+
+#include "Utils.h"
+#include "MPFSimpleConfigLoader.h"
+
+
+using std::string;
+using std::vector;
+using std::map;
+using std::pair;
+using std::runtime_error;
+
+using cv::Point;
+using cv::Point2f;
+using cv::Mat;
+using cv::Rect;
+using cv::Scalar;
+using cv::Size;
+using cv::RotatedRect;
+using cv::Size2f;
+using cv::namedWindow;
+using cv::destroyAllWindows;
+using cv::waitKey;
+using cv::KeyPoint;
+using cv::resize;
+using cv::rectangle;
+
+using log4cxx::Logger;
+
+using namespace MPF;
+using namespace COMPONENT;
+
+bool OcvFaceTracker::Init(std::string &plugin_path) {
+    OpenFaceDetectionLogger = log4cxx::Logger::getLogger("OcvFaceDetection");
+
+    if (!ocv_detection.Init(plugin_path)) {
+        LOG4CXX_ERROR(OpenFaceDetectionLogger, "Failed to initialize OpenCV Detection");
+        return false;
+    }
+
+    //the parameters read here are shared by all jobs - each job copies them into its own context with
+    //SetReadConfigParameters()
+    string config_params_path = plugin_path + "/config/mpfOcvFaceDetection.ini";
+    int rc = LoadConfig(config_params_path, parameters);
+    if (rc) {
+        LOG4CXX_ERROR(OpenFaceDetectionLogger, "Failed to load the OcvFaceDetection config from: " << config_params_path);
+        return (false);
+    }
+
+    return true;
+}
+
+void OcvFaceTracker::SetModes(bool display_window, bool print_debug_info) {
+    //each job reads IMSHOW_ON from the config parameters
+    parameters["IMSHOW_ON"] = display_window ? "1" : "0";
+
+    if (print_debug_info && OpenFaceDetectionLogger != NULL) {
+        OpenFaceDetectionLogger->setLevel(log4cxx::Level::getDebug());
+    }
+}
+
+bool OcvFaceTracker::IsImshowOn() const {
+    return parameters.value("IMSHOW_ON").toInt() > 0;
+}
+
+void OcvFaceTracker::InitJobContext(const map<string, string> &algorithm_properties, OcvFaceJobContext &context) {
+    SetDefaultParameters(context);
+    SetReadConfigParameters(context);
+    GetPropertySettings(algorithm_properties, context);
+    CheckoutDetector(context);
+}
+
+void OcvFaceTracker::SetDefaultParameters(OcvFaceJobContext &context) {
+    context.max_features = 250;
+
+    //limiting the number of corners to 250 by default
+    context.feature_detector = cv::GFTTDetector::create(context.max_features);
+
+    context.min_face_size = 48;
+
+    //detect on the full frame, every frame
+    context.detection_max_frame_dimension = 0;
+    context.detection_frame_interval = 1;
+
+    //the lbp cascade - the dnn input size and confidence are only used by the dnn detector
+    context.detector_type = "CASCADE";
+    context.dnn_input_size = 300;
+    context.dnn_min_confidence = 0.5f;
+
+    //this should be adjusted based on type of detector
+    context.min_init_point_count = 45;
+
+    //point at which the track should be considered lost
+    context.min_point_percent = 0.70;
+
+    //the point at which points will be redetected
+    context.min_redetect_point_perecent = 0.88;
+
+    context.min_initial_confidence = 10.0f;
+
+    //not currently used - but could be used to help stops tracks earlier when there is a lot
+    //of error when detecting the next points using calcopticalflow
+    context.max_optical_flow_error = 4.7;;
+}
+
+void OcvFaceTracker::SetReadConfigParameters(OcvFaceJobContext &context) {
+    //make sure none of the parameters are missed in the config file - double check
+    context.imshow_on = parameters.value("IMSHOW_ON").toInt();
+
+    context.min_init_point_count = parameters.value("MIN_INIT_POINT_COUNT").toInt();
+
+    context.min_point_percent = parameters.value("MIN_POINT_PERCENT").toFloat();
+    context.min_initial_confidence = parameters.value("MIN_INITIAL_CONFIDENCE").toFloat();
+
+    context.min_face_size = parameters.value("MIN_FACE_SIZE").toInt();
+
+    if (parameters.contains("DETECTOR_TYPE")) {
+        context.detector_type = parameters.value("DETECTOR_TYPE").toUpper().toStdString();
+    }
+    if (parameters.contains("DNN_INPUT_SIZE")) {
+        context.dnn_input_size = parameters.value("DNN_INPUT_SIZE").toInt();
+    }
+    if (parameters.contains("DNN_MIN_CONFIDENCE")) {
+        context.dnn_min_confidence = parameters.value("DNN_MIN_CONFIDENCE").toFloat();
+    }
+
+    //right now only accepting a verbosity of 1 and just checking for > 0, may need to adjust later
+    //if verbosity 1 set the log level to DEBUG
+    //if verbosity set to 2, think about using TRACE
+    context.verbosity = parameters.value("VERBOSE").toInt();
+    if (context.verbosity > 0) {
+        OpenFaceDetectionLogger->setLevel(log4cxx::Level::getDebug());
+    }
+}
+
+/* This function reads a property value map and adjusts the settings for this component. */
+void OcvFaceTracker::GetPropertySettings(const map <string, string> &algorithm_properties,
+                                         OcvFaceJobContext &context) {
+    string property;
+    string str_value;
+    int ivalue;
+    float fvalue;
+    for (map<string, string>::const_iterator imap = algorithm_properties.begin();
+         imap != algorithm_properties.end(); imap++) {
+        property = imap->first;
+        str_value = imap->second;
+
+        //TODO: could restrict some of the parameter ranges here and log like PP!
+        if (property == "MIN_FACE_SIZE") { //INT
+            context.min_face_size = atoi(str_value.c_str());
+        }
+        else if (property == "MAX_FEATURE") { //INT
+            context.max_features = atoi(str_value.c_str());
+        }
+        else if (property == "DETECTION_MAX_FRAME_DIMENSION") { //INT
+            context.detection_max_frame_dimension = atoi(str_value.c_str());
+        }
+        else if (property == "DETECTION_FRAME_INTERVAL") { //INT
+            context.detection_frame_interval = std::max(1, atoi(str_value.c_str()));
+        }
+        else if (property == "DETECTOR_TYPE") { //STRING
+            context.detector_type = QString::fromStdString(str_value).toUpper().toStdString();
+        }
+        else if (property == "DNN_INPUT_SIZE") { //INT
+            context.dnn_input_size = std::max(1, atoi(str_value.c_str()));
+        }
+        else if (property == "DNN_MIN_CONFIDENCE") { //FLOAT
+            context.dnn_min_confidence = atof(str_value.c_str());
+        }
+        if (property == "MIN_INIT_POINT_COUNT") { //INT
+            context.min_init_point_count = atoi(str_value.c_str());
+        }
+        else if (property == "MIN_POINT_PERCENT") { //FLOAT
+            context.min_point_percent = atof(str_value.c_str());
+        }
+        else if (property == "MIN_INITIAL_CONFIDENCE") { //FLOAT
+            context.min_initial_confidence = atof(str_value.c_str());
+        }
+        else if (property == "MAX_OPTICAL_FLOW_ERROR") { //FLOAT
+            context.max_optical_flow_error = atof(str_value.c_str());
+        }
+        else if (property == "VERBOSE") { //INT
+            context.verbosity = atoi(str_value.c_str());
+        }
+    }
+    return;
+}
+
+void OcvFaceTracker::CheckoutDetector(OcvFaceJobContext &context) {
+    if (context.detector_type == "DNN") {
+        if (!ocv_detection.IsDnnInitialized()) {
+            throw MPFDetectionException(MPF_COULD_NOT_READ_DATAFILE,
+                                        "The DNN face detector was requested, but its model could not be loaded.");
+        }
+        context.dnn_face_net = ocv_detection.CheckoutDnnNet();
+    }
+    else if (context.detector_type == "CASCADE") {
+        context.face_cascade = ocv_detection.CheckoutCascade();
+    }
+    else {
+        throw MPFDetectionException(MPF_INVALID_PROPERTY,
+                                    "Invalid DETECTOR_TYPE of \"" + context.detector_type
+                                    + "\". It must be either CASCADE or DNN.");
+    }
+}
+
+vector<pair<Rect, int>> OcvFaceTracker::DetectFaces(const OcvFaceJobContext &context, const Mat &frame,
+                                                    const Mat &frame_gray) {
+    if (context.detector_type == "DNN") {
+        //the dnn does its own resizing, so DETECTION_MAX_FRAME_DIMENSION is not needed
+        return ocv_detection.DetectFacesDnn(*context.dnn_face_net, frame, context.min_face_size,
+                                            context.dnn_input_size, context.dnn_min_confidence);
+    }
+    return ocv_detection.DetectFaces(*context.face_cascade, frame_gray, context.min_face_size,
+                                     context.detection_max_frame_dimension);
+}
+
+vector<pair<Rect, int>> OcvFaceTracker::DetectFacesInImage(const OcvFaceJobContext &context, const Mat &image,
+                                                          const Mat &image_gray) {
+    //the cascade keeps its original defaults for images
+    if (context.detector_type == "DNN") {
+        return DetectFaces(context, image, image_gray);
+    }
+    return ocv_detection.DetectFaces(*context.face_cascade, image_gray);
+}
+
+void OcvFaceTracker::Display(const OcvFaceJobContext &context, const string title, const Mat &img) {
+    if (context.imshow_on) {
+        imshow(title, img);
+        waitKey(5);
+    }
+}
+
+Rect OcvFaceTracker::GetMatch(const Mat &frame_gray, const Mat &templ, const Rect &search_rect) {
+    //no clue what method is best - default of the opencv demo
+    int match_method = CV_TM_CCOEFF_NORMED;
+
+    //only the part of the frame within the search window is matched - the window must be at least the size of the
+    //template
+    Rect search_window = search_rect & Rect(0, 0, frame_gray.cols, frame_gray.rows);
+    if (search_window.width < templ.cols || search_window.height < templ.rows) {
+        return Rect(0, 0, 0, 0);
+    }
+
+    /// Do the Matching - the result is not normalized since only the location of the best match is needed
+    Mat result;
+    matchTemplate(frame_gray(search_window), templ, result, match_method);
+
+    /// Localizing the best match with minMaxLoc
+    double minVal;
+    double maxVal;
+    Point minLoc;
+    Point maxLoc;
+    Point matchLoc;
+
+    minMaxLoc(result, &minVal, &maxVal, &minLoc, &maxLoc, Mat());
+
+    /// For SQDIFF and SQDIFF_NORMED, the best matches are lower values. For all the other methods, the higher the better
+    if (match_method == CV_TM_SQDIFF || match_method == CV_TM_SQDIFF_NORMED) { matchLoc = minLoc; }
+    else { matchLoc = maxLoc; }
+
+    //the match location is relative to the search window
+    Rect match_rect(search_window.x + matchLoc.x, search_window.y + matchLoc.y, templ.cols, templ.rows);
+
+    return match_rect;
+}
+
+bool OcvFaceTracker::IsExistingTrackIntersection(const OcvFaceJobContext &context, const Rect new_rect,
+                                                 int &intersection_index) {
+    intersection_index = -1;
+
+    for (vector<Track>::const_iterator track = context.current_tracks.begin(); track != context.current_tracks.end(); ++track) {
+        ++intersection_index;
+
+        //if the track is new then there should still be a face detection
+        MPFImageLocation last_face_detection = MPFImageLocation(track->face_track.frame_locations.rbegin()->second); // last element in map
+
+        Rect existing_rect = Utils::ImageLocationToCvRect(last_face_detection);
+
+        Rect intersection = existing_rect & new_rect; // (rectangle intersection)
+
+        //important: just returning the index with any sort of intersection will cause issues
+        //if there are faces in close proximity and there is more than one intersection
+        //need to loop through all intersecting rects and choose the one with the most intersection
+        //and that will be the correct intersection index
+        //important: should allow for a small intersection for faces in close proximity - like 10 - 20%
+        if (intersection.area() > ceil(static_cast<float>(existing_rect.area()) * 0.15)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Rect OcvFaceTracker::GetUpscaledFaceRect(const Rect &face_rect) {
+    return Rect(
+            face_rect.x + static_cast<int>( -0.214 * static_cast<float>(face_rect.width)),
+            face_rect.y + static_cast<int>( -0.055 * static_cast<float>(face_rect.height)),
+            static_cast<int>( 1.4286 * static_cast<float>(face_rect.width)),
+            static_cast<int>( 1.11 * static_cast<float>(face_rect.height)));
+}
+
+Mat OcvFaceTracker::GetMask(const Mat &frame, const Rect &face_rect, Rect &mask_rect, bool copy_face_rect) {
+    //Downsize the bounding box so that only the 'face' is shown
+    Rect rescaled_face = Rect(
+            face_rect.x + static_cast<int>( 0.15 * static_cast<float>(face_rect.width)),
+            face_rect.y + static_cast<int>( 0.05 * static_cast<float>(face_rect.height)),
+            static_cast<int>( 0.7 * static_cast<float>(face_rect.width)),
+            static_cast<int>( 0.9 * static_cast<float>(face_rect.height)));
+
+    //the mask only covers the part of the frame that contains the rescaled face - everything outside of it
+    //would be zero anyway
+    mask_rect = rescaled_face & Rect(0, 0, frame.cols, frame.rows);
+
+    //create a single channel zero matrix the size of the face
+    Mat image_mask;
+    image_mask = Mat::zeros(mask_rect.size(), CV_8UC1);
+
+    //using a best fit ellipse in an attempt to remove any "non-face" image parts from the face bounding box
+    //find the center of the rescaled face relative to the mask
+    Point2f center(static_cast<float>( rescaled_face.x - mask_rect.x + 0.5 * static_cast<float>(rescaled_face.width)),
+                   static_cast<float>( rescaled_face.y - mask_rect.y + 0.5 * static_cast<float>(rescaled_face.height)));
+    RotatedRect rotated_rect;
+    rotated_rect.center = center;
+    rotated_rect.size = Size2f(static_cast<float>(rescaled_face.width), static_cast<float>(rescaled_face.height));
+    //finding the face angle would greatly improve the results of the initial point detection
+    //would allow for using a rotated rect!! - possible future improvement
+    rotated_rect.angle = 0.0f;
+    //draw the ellipse on the black frame to create the mask
+    ellipse(image_mask, rotated_rect, Scalar(255), CV_FILLED);
+
+    if (copy_face_rect) {
+        //Copy face to masked image
+        frame(mask_rect).copyTo(image_mask, image_mask);
+    }
+
+    return image_mask;
+}
+
+void OcvFaceTracker::DetectFaceKeypoints(const OcvFaceJobContext &context, const Mat &frame_gray,
+                                         const Rect &face_rect, vector<KeyPoint> &keypoints) {
+    //only the face region is searched - the mask excludes the parts of the region that are not the face
+    Rect mask_rect;
+    Mat mask = GetMask(frame_gray, face_rect, mask_rect);
+    keypoints.clear();
+    if (mask.empty()) {
+        return;
+    }
+    context.feature_detector->detect(frame_gray(mask_rect), keypoints, mask);
+
+    //the keypoints are relative to the face region - move them back to frame coordinates
+    Point2f offset(static_cast<float>(mask_rect.x), static_cast<float>(mask_rect.y));
+    for (vector<KeyPoint>::iterator keypoint = keypoints.begin(); keypoint != keypoints.end(); ++keypoint) {
+        keypoint->pt += offset;
+    }
+}
+
+bool OcvFaceTracker::IsBadFaceRatio(const Rect &face_rect) {
+    //trying to find a way to kill tracks when points grab onto something outside of the face and the face
+    //bounding box ratio becomes odd
+    //if bounding rect width is much more than the height there is an issue or if the area of the enclosing circle
+    //is much greater than the bounding rect area
+
+    float face_ratio = static_cast<float>(face_rect.width) / static_cast<float>(face_rect.height);
+    float target_face_ratio = 0.75;
+    //the threshold for greater than should be bigger than the threshold for less than - face rects could be very thin if equal
+    float max_increase_face_ratio_deviation = 0.35;
+    float max_decrease_face_ratio_deviation = -0.25;
+    float face_ratio_diff = face_ratio - target_face_ratio;
+    //should check this ratio at track creation..
+
+    if ((face_ratio_diff > max_increase_face_ratio_deviation ||
+         face_ratio_diff < max_decrease_face_ratio_deviation)) {
+        return true;
+    }
+
+    return false;
+}
+
+void OcvFaceTracker::CloseAnyOpenTracks(OcvFaceJobContext &context, int frame_index) {
+    if (!context.current_tracks.empty()) {
+        //need to stop all current tracks!
+        for (vector<Track>::iterator it = context.current_tracks.begin(); it != context.current_tracks.end(); it++) {
+            //grab last track - the current tracks are cleared after this, so the track can be moved
+            Track &track = *it;
+            //should never happen - but ignoring the track
+            if (track.face_track.stop_frame != -1) {
+                continue;
+            }
+
+            //track is still going at end index
+            //set the stopFrame for this track!!!
+            track.face_track.stop_frame = frame_index;
+
+            //now the track can be saved
+            context.saved_tracks.push_back(std::move(track));
+        }
+    }
+}
+
+void OcvFaceTracker::AdjustRectToEdges(Rect &rect, const Mat &src) {
+    if (!src.empty()) {
+        //check corners and edges and resize appropriately!
+
+        //modifying the referenced rect
+        //subtracting 1 since indexes are 0 based, if image is 256x256 there is will be 256 rows and cols,
+        //but the values will range from 0 to 255
+        int x_max = (src.cols - 1);
+        int y_max = (src.rows - 1);
+
+        //x
+        int x_adj = 0;
+        if (rect.x < 0) {
+            //subtract the negative value
+            x_adj = 0 - rect.x;
+            rect.x = 0;
+        }
+            //rect.x should never be greater than image bounds, the bounding box would start outside of the image
+        else if ((rect.x + rect.width) > x_max) {
+            x_adj = (rect.x + rect.width) - x_max;;
+        }
+
+        //y
+        int y_adj = 0;
+        if (rect.y < 0) {
+            //subtract the negative value
+            y_adj = 0 - rect.y;
+            rect.y = 0;
+        }
+            //rect.y should never be greater than image bounds, the bounding box would start outside of the image
+        else if ((rect.y + rect.height) > y_max) {
+            y_adj = (rect.y + rect.height) - y_max;
+        }
+
+        //now adjust width and height
+        //adjustment values shouldn't be negative
+        if (x_adj > 0) {
+            rect.width = rect.width - x_adj;
+        }
+
+        if (y_adj > 0) {
+            rect.height = rect.height - y_adj;
+        }
+
+        //the rect may still have a width and/or height greater than src and that must be adjusted
+        if (rect.height > src.rows) {
+            rect.height = src.rows;
+        }
+
+        if (rect.width > src.cols) {
+            rect.width = src.cols;
+        }
+    }
+}
+
+/* Updates a single track with the optical flow points and the faces detected in the current frame. The track is
+ * marked as lost if it can't be continued. Only the given track is modified, so different tracks can be updated
+ * at the same time unless frames are being displayed. */
+void OcvFaceTracker::UpdateTrack(const OcvFaceJobContext &context, Track &track, const vector<Point2f> &new_points,
+                                 const vector<uchar> &status,
+                                 const vector<pair<Rect, int>> &faces, bool detect_faces, const Mat &gray,
+                                 const Mat &prev_gray, int frame_index, const string &job_name,
+                                 Mat &frame_draw) {
+    Mat frame_draw_pre_verified;
+
+    //assume track lost at start
+    track.track_lost = true;
+
+    if (track.previous_points.empty()) {
+        //should never get here!! - current points of first detection will be swapped to previous!!
+        //kill the track if this case does occur
+        LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                   << "] Track contains no previous points - killing tracks");
+        return;
+    }
+
+    //stores the detected rect properly matched up to the current track
+    //if certain requirements are met
+    pair<Rect, int> correct_detected_rect_pair;
+    correct_detected_rect_pair.first = Rect(0, 0, 0, 0);
+
+    //set to true if template matching is used to keep the track going
+    //this will be used to determine if points can be redetected
+    bool track_recovered = false;
+
+    if (new_points.empty()) {
+        //no new points - this track will be killed
+        LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                   << "] Optical flow could not find any new points - killing track");
+        return;
+    }
+    else {
+        //don't want to display any of the drawn points or bounding boxes of tracks that aren't kept
+        if (context.imshow_on) {
+            frame_draw_pre_verified = frame_draw.clone();
+        }
+
+        //store the correct bounding box here
+        //Rect final_bounding_box(0,0,0,0);
+
+        //GOAL: try to find the current detection with the most contained points
+        //the goal is to use the opencv bounding box rather than estimate one using
+        //an enclosed circle and a bounding rect
+        //it will also be good to remove points not in this bounding box to improve the continued tracking
+        //Rect correct_detected_rect(0,0,0,0);
+
+        int points_within_detected_rect = 0;
+        //store the percentage of intersection for each detected face
+        map <int, float> rect_point_percentage_map;
+        int face_rect_index = 0;
+        for (vector <pair<Rect, int>>::const_iterator face_rect = faces.begin(); face_rect != faces.end(); ++face_rect) {
+            points_within_detected_rect = 0;
+
+            for (unsigned i = 0; i < new_points.size(); i++) { //TODO: could also use the err vector (from calcOpticalFlowPyrLK) with a float threshold
+                if (face_rect->first.contains(new_points[i])) {
+                    ++points_within_detected_rect;
+                }
+            }
+
+            //if points were found inside one of the rects then it needs to be stored in the map
+            if (points_within_detected_rect > 0) {
+                rect_point_percentage_map[face_rect_index] = (static_cast<float>(points_within_detected_rect) /
+                                                              static_cast<float>(new_points.size()));
+            }
+
+            ++face_rect_index;
+        }
+
+        //TODO: could combine this with the loop above
+        //also probably want the best intersection percentage to be > 75 or 80 percent
+        // - if only a few points are intersecting then there is clearly an issue
+        //float best_intersection_percentage = 0.0;
+        //must be greater than 0.75
+        float best_intersection_percentage = 0.75;
+        for (map<int, float>::iterator map_iter = rect_point_percentage_map.begin();
+             map_iter != rect_point_percentage_map.end(); ++map_iter) {
+            float intersection_percentage(map_iter->second);
+            if (intersection_percentage > best_intersection_percentage) {
+                best_intersection_percentage = intersection_percentage;
+                correct_detected_rect_pair = faces[map_iter->first];
+            }
+        }
+
+        //if enters here means there is good point intersection with a detected rect
+        if (correct_detected_rect_pair.first.area() > 0) {
+            //have to clear the old points first!
+            track.current_points.clear();
+            //only add new points if they are a '1' in the status vector and within the correctly detected rect!!
+            //TODO: could also use the err vector with a float threshold
+            for (unsigned i = 0; i < status.size(); i++) {
+                if (static_cast<int>(status[i])) {
+                    //TODO: keep track of how many missed detections per track - think about stopping the track if not
+                    //detecting the face for a few frames in a row
+                    //only keep if within the correct detected face rect
+                    if (correct_detected_rect_pair.first.contains(new_points[i])) {
+                        track.current_points.push_back(new_points[i]);
+                        if (context.imshow_on) {
+                            circle(frame_draw_pre_verified, new_points[i], 2, Scalar(255, 255, 255), CV_FILLED);
+                        }
+                    }
+                    else if (context.imshow_on) {
+                        circle(frame_draw_pre_verified, new_points[i], 2, Scalar(0, 0, 255), CV_FILLED);
+                    }
+                }
+            }
+        }
+        else if (!detect_faces) {
+            //faces were not detected on this frame - move the last face by the median motion of the points
+            track.current_points.clear();
+            vector<float> x_shifts;
+            vector<float> y_shifts;
+            for (unsigned i = 0; i < status.size(); i++) {
+                if (static_cast<int>(status[i])) {
+                    track.current_points.push_back(new_points[i]);
+                    x_shifts.push_back(new_points[i].x - track.previous_points[i].x);
+                    y_shifts.push_back(new_points[i].y - track.previous_points[i].y);
+                }
+            }
+
+            if (track.current_points.empty()) {
+                LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                           << "] Optical flow could not track any points - killing track");
+                return;
+            }
+
+            std::nth_element(x_shifts.begin(), x_shifts.begin() + x_shifts.size() / 2, x_shifts.end());
+            std::nth_element(y_shifts.begin(), y_shifts.begin() + y_shifts.size() / 2, y_shifts.end());
+            Point shift(cvRound(x_shifts[x_shifts.size() / 2]), cvRound(y_shifts[y_shifts.size() / 2]));
+
+            const MPFImageLocation &last_face = track.face_track.frame_locations.rbegin()->second; // last element in map
+            Rect moved_face_rect = (Utils::ImageLocationToCvRect(last_face) + shift)
+                                   & Rect(0, 0, gray.cols, gray.rows);
+            if (moved_face_rect.area() <= 0) {
+                LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                           << "] Face moved out of the frame - killing track");
+                return;
+            }
+
+            //no detector ran on this frame, so the face has a confidence of 0 like a template matched face
+            correct_detected_rect_pair.first = moved_face_rect;
+            correct_detected_rect_pair.second = 0;
+
+            //the points are only redetected on frames where faces are detected
+            track_recovered = true;
+        }
+        else {
+            //if turning the additional three displays on then make sure they are killed when finished tracking or detecting!
+            //Display("current frame at lost face", frame);
+
+            //have to clear the old points first! - points are still in the new points vector
+            track.current_points.clear();
+
+            //add all of the points
+            track.current_points = new_points;
+
+            if (context.imshow_on) {
+                //draw the points as red
+                for (unsigned i = 0; i < new_points.size(); i++) {
+                    circle(frame_draw_pre_verified, new_points[i], 2, Scalar(0, 0, 255), CV_FILLED);
+                }
+
+                //draw a circle around the points
+                Point2f center;
+                float radius;
+                minEnclosingCircle(track.current_points, center, radius);
+                //radius is increased
+                circle(frame_draw_pre_verified, center, radius * 1.2, Scalar(255, 255, 255), 1, 8);
+            }
+
+            //get a bound rect using the current points
+            Rect face_rect = boundingRect(track.current_points);
+            //check to see how small the bounding rect is
+            if (face_rect.height < 32) //face_rect.width < 32 ||
+            {
+                //if face smaller than 32 pixels then we don't want to keep it
+                LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                           << "] Face too small to track - killing track");
+                return;
+            }
+
+            //increase size since the size was decreased when detecting the points
+            Rect upscaled_face = GetUpscaledFaceRect(face_rect);
+            if (context.imshow_on) {
+                rectangle(frame_draw_pre_verified, face_rect, Scalar(255, 255, 0));
+            }
+
+            LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name << "] Getting template match");
+
+            //try template matching
+            //make sure the template is not out of bounds
+            AdjustRectToEdges(upscaled_face, gray);
+
+            //get first face - TODO: might not be the best face - should use the quality tool if available
+            //or could use the last face
+            Rect last_face_rect = Utils::ImageLocationToCvRect(track.face_track.frame_locations.rbegin()->second); // last element in map
+            Mat templ = prev_gray(last_face_rect);
+
+            //Display("last face", templ);
+
+            //a match is only kept if it covers enough of the last face, so the match can't be offset from
+            //the last face by more than (1 - min_template_intersection_rate) of the face size in either
+            //direction - only that window needs to be searched
+            const float min_template_intersection_rate = 0.7f;
+            int max_offset_x = cvCeil(last_face_rect.width * (1.0f - min_template_intersection_rate));
+            int max_offset_y = cvCeil(last_face_rect.height * (1.0f - min_template_intersection_rate));
+            Rect search_rect(last_face_rect.x - max_offset_x, last_face_rect.y - max_offset_y,
+                             last_face_rect.width + 2 * max_offset_x,
+                             last_face_rect.height + 2 * max_offset_y);
+
+            Rect match_rect = GetMatch(gray, templ, search_rect);
+
+            LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name << "] Match rect area: "
+                                                       << match_rect.area());
+
+            Rect match_intersection = match_rect & last_face_rect; //opencv allows for this operation
+
+            if (context.imshow_on) {
+                Mat new_frame_copy = frame_draw.clone();
+                rectangle(new_frame_copy, match_rect, Scalar(255, 255, 255), 2);
+                //draw the previous face even though it was from the previous frame
+                rectangle(new_frame_copy, last_face_rect, Scalar(0, 255, 0), 2);
+                rectangle(new_frame_copy, match_intersection, Scalar(255, 0, 0), 2);
+                //Display("intersection", new_frame_copy);
+            }
+
+            LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name << "] Finished getting match");
+
+            //look for a certain percentage of intersection
+            if (match_intersection.area() > 0) {
+                float intersection_rate = static_cast<float>(match_intersection.area()) /
+                                          static_cast<float>(last_face_rect.area());
+
+                LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name << "] Intersection rate: "
+                                                           << intersection_rate);
+
+                //was at 0.5 - should be much higher - don't want to be very permissive here - the template
+                //matching is not that good - TODO: need some sort of score could use openbr to do matching
+                if (intersection_rate < min_template_intersection_rate) {
+                    return;
+                }
+            }
+            else {
+                return;
+            }
+
+            //NEED TO TRIM THE POINTS TO THE TEMPLATE MATCH RECT!!!
+            //some of the calc optical flow next points will start to get away!!
+            //TODO: make sure to set the actual rect to the template rect
+
+            //set the rescaled face that is used for the object detection to the template match
+            correct_detected_rect_pair.first = match_rect;
+
+            //set to true to make sure we don't redetect points in this case
+            track_recovered = true;
+
+            int points_within_template_match_rect = 0;
+            vector <Point2f> temp_points_copy(track.current_points);
+            //have to be cleared once again
+            track.current_points.clear();
+
+            //for(unsigned i=0; i < track.current_points.size(); i++)
+            for (unsigned i = 0; i < temp_points_copy.size(); i++) {
+                //USING the match intersection rect - might fix some issues with there is a transition in the video
+                //- might want to use the intserection for the actual face rect as well
+                if (match_rect.contains(temp_points_copy[i])) {
+                    //TODO: need to check the count of these points - also need to kill the track if a bounding
+                    //rect of these new points gets to be too small!!!
+                    track.current_points.push_back(temp_points_copy[i]);
+                    ++points_within_template_match_rect;
+
+                }
+            }
+        }
+
+
+        //TODO: does it seem necessary to do this again?
+        //check corrected rect area again to check point percent
+        if (correct_detected_rect_pair.first.area() > 0) {
+            //now can check the point percentage!
+            float current_point_percent = static_cast<float>(track.current_points.size()) /
+                                          static_cast<float>(track.init_point_count);
+
+            //TODO: probably need an intersection rate specific to the track continuation
+            //update current track info
+            track.current_point_count = static_cast<int>(track.current_points.size());
+            track.current_point_percent = current_point_percent;
+
+            if (current_point_percent < context.min_point_percent) {
+                //lost too many of original points - kill track
+                //set something to continue onto the feature matching portion - no reason to kill the track here
+                LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                           << "] Lost too many points, current percent: " << current_point_percent);
+                return;
+            }
+        }
+    }
+
+    bool redetect_feature_points = true;
+
+    //if a face bounding box is now set and we can redetect feature points
+    //if track is not recovered
+    if(correct_detected_rect_pair.first.area() > 0 && redetect_feature_points &&
+       !track_recovered && track.current_point_percent < context.min_redetect_point_perecent) {
+        LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                   << "] Attempting to redetect feature points");
+        vector <KeyPoint> keypoints;
+        //search for keypoints within the face
+        DetectFaceKeypoints(context, gray, correct_detected_rect_pair.first, keypoints);
+
+        //calcOpticalFlowPyrLK uses float points - no need to store the KeyPoint vector - convert
+        track.current_points.clear(); //why not clear before
+        KeyPoint::convert(keypoints, track.current_points);
+
+        //min init point count should be different for each detector!
+        //TODO: not sure if I want to kill the track here - just don't update the init point count and continue
+        if(keypoints.size() < context.min_init_point_count)
+        {
+            LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name << "] Not enough initial points: " <<
+                                                       static_cast<int>(track.current_points.size()));
+
+            //set the init to min init point count because we are now below that
+            track.init_point_count = context.min_init_point_count;
+            track.current_point_count = static_cast<int>(track.current_points.size());
+
+            //now need to re-check the percentage - TODO: put this in a member function
+            float current_point_percent = static_cast<float>(track.current_points.size()) /
+                                          static_cast<float>(track.init_point_count);
+            //set track info for display
+            track.current_point_count = static_cast<int>(track.current_points.size());
+            track.current_point_percent = current_point_percent;
+
+            if (current_point_percent < context.min_point_percent) {
+                //lost too many of original points - kill track
+                LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                           << "] Lost too many points below min point percent, "
+                                                           << "current percent: " << current_point_percent);
+                return;
+            }
+
+            LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                       << "] Keeping track below context.min_init_point_count with current percent: "
+                                                       << current_point_percent);
+        }
+        else {
+            //reset the init and current point count also!
+            track.init_point_count = static_cast<int>(track.current_points.size());
+            track.current_point_count = track.init_point_count;
+        }
+
+        //must update the last detection index!
+        track.last_face_detected_index = frame_index;
+    }
+
+    //at this point if the correct detected rect has an area we can keep the track
+    if (correct_detected_rect_pair.first.area() > 0) {
+        if (context.imshow_on) {
+            rectangle(frame_draw_pre_verified, correct_detected_rect_pair.first, Scalar(0, 255, 0), 2);
+        }
+
+        //don't want to store a face that isn't within the bounds of the image
+        AdjustRectToEdges(correct_detected_rect_pair.first, gray);
+        MPFImageLocation fd = Utils::CvRectToImageLocation(correct_detected_rect_pair.first);
+
+        fd.confidence = static_cast<float>(correct_detected_rect_pair.second);
+        //can finally store the MPFImageLocation
+        track.face_track.frame_locations.insert(pair<int, MPFImageLocation>(frame_index, fd));
+        track.face_track.confidence = std::max(track.face_track.confidence, fd.confidence);
+    }
+    else {
+        return;
+    }
+
+    //if makes it here then we want to keep the track!!
+    track.track_lost = false;
+    //can also set the frame_draw to frame_draw_pre_verified Mat - TODO: should think of showing the pre verified Mat if the
+    //track is lost
+    if (context.imshow_on) {
+        frame_draw = frame_draw_pre_verified.clone();
+    }
+}
+
+/* Detects faces in a single frame and updates the open tracks of the job with it. The frames of a job must be passed
+ * in order - the previous frame and the open tracks are kept in the context, so a job can be processed one frame at
+ * a time. */
+void OcvFaceTracker::TrackFrame(OcvFaceJobContext &context, const Mat &frame, int frame_index,
+                                const string &job_name) {
+    Mat frame_draw;
+    Mat gray;
+
+    //the same values calcOpticalFlowPyrLK uses by default
+    const Size optical_flow_win_size(21, 21);
+    const int optical_flow_max_level = 3;
+
+    if (context.imshow_on) {
+        //create copy of frame to draw on for display
+        frame_draw = frame.clone();
+    }
+
+    //Convert to grayscale
+    gray = Utils::ConvertToGray(frame);
+
+    //look for new faces
+    bool detect_faces = context.frames_until_detection <= 0 || context.track_lost_on_previous_frame;
+    vector <pair<Rect, int>> faces;
+    if (detect_faces) {
+        faces = DetectFaces(context, frame, gray);
+        context.frames_until_detection = context.detection_frame_interval;
+        ++context.detection_frame_count;
+    }
+    --context.frames_until_detection;
+    context.track_lost_on_previous_frame = false;
+    //draw all new face bounding boxes on the screen for debugging
+    if (context.imshow_on) {
+        for (vector <pair<Rect, int>>::iterator face_rect = faces.begin(); face_rect != faces.end(); ++face_rect) {
+            rectangle(frame_draw, ((*face_rect).first), Scalar(204, 0, 204), 2, 4);
+        }
+    }
+
+    //the optical flow for the points of all tracks is calculated in a single call
+    //the points for track i are in the range [track_point_offsets[i], track_point_offsets[i + 1])
+    vector <Point2f> all_previous_points;
+    vector <size_t> track_point_offsets;
+    for (vector<Track>::iterator track = context.current_tracks.begin(); track != context.current_tracks.end(); ++track) {
+        track_point_offsets.push_back(all_previous_points.size());
+        all_previous_points.insert(all_previous_points.end(), track->previous_points.begin(),
+                                   track->previous_points.end());
+    }
+    track_point_offsets.push_back(all_previous_points.size());
+
+    vector <Point2f> all_new_points;
+    vector <uchar> all_status;
+    vector <float> all_err;
+    if (!all_previous_points.empty()) {
+        buildOpticalFlowPyramid(gray, context.pyramid, optical_flow_win_size, optical_flow_max_level);
+        calcOpticalFlowPyrLK(context.prev_pyramid, context.pyramid, all_previous_points, all_new_points, all_status, all_err,
+                             optical_flow_win_size, optical_flow_max_level);
+    }
+
+    //the tracks only depend on the detected faces and their own points, so they are updated in parallel -
+    //new tracks are added afterwards in order, so the results are the same as updating the tracks one at a time
+    auto update_tracks = [&](const cv::Range &range) {
+        for (int track_index = range.start; track_index < range.end; ++track_index) {
+            size_t points_begin = track_point_offsets[track_index];
+            size_t points_end = track_point_offsets[track_index + 1];
+            vector <Point2f> new_points(all_new_points.begin() + points_begin, all_new_points.begin() + points_end);
+            vector <uchar> status(all_status.begin() + points_begin, all_status.begin() + points_end);
+
+            UpdateTrack(context, context.current_tracks[track_index], new_points, status, faces, detect_faces, gray,
+                        context.prev_gray, frame_index, job_name, frame_draw);
+        }
+    };
+    cv::Range track_range(0, static_cast<int>(context.current_tracks.size()));
+    if (context.imshow_on) {
+        //the tracks are drawn on the same frame
+        update_tracks(track_range);
+    }
+    else {
+        cv::parallel_for_(track_range, update_tracks);
+    }
+
+    //draw before killing bad tracks and adding new tracks!
+    if (context.imshow_on) {
+        vector <MPFVideoTrack> temp_tracks;
+        //TODO: annoying to have to do this conversion - also losing point count info
+        //TODO: need to store tracker point info in a different way to keep from having to do this conversion so many times!!
+        for (vector<Track>::iterator cur_track = context.current_tracks.begin(); cur_track != context.current_tracks.end(); ++cur_track) {
+            temp_tracks.push_back(cur_track->face_track);
+        }
+        vector <MPFImageLocation> empty_locations;
+        Utils::DrawTracks(frame_draw, temp_tracks, empty_locations, static_cast<int>(context.saved_tracks.size()));
+        Utils::DrawText(frame_draw, frame_index);
+
+        //might not be a bad idea to update the display twice
+        Display(context, "Open Tracker", frame_draw);
+    }
+
+    //check if there is intersection between new objects and existing tracks
+    //if not then add the new tracks
+    for (unsigned i = 0; i < faces.size(); ++i) {
+        int intersection_index = -1;
+        if (!IsExistingTrackIntersection(context, faces[i].first, intersection_index)) {
+            Track track_new;
+
+            //set face detection
+            Rect face(faces[i].first);
+            AdjustRectToEdges(face, gray);
+
+            float first_face_confidence = static_cast<float>(faces[i].second);
+
+            bool use_face = false;
+            if (first_face_confidence > context.min_initial_confidence) {
+                use_face = true;
+            }
+            else {
+                if(context.imshow_on) {
+                    //draw the track detection red for bad quality
+                    rectangle(frame_draw, face, Scalar(0, 0, 255), 3);
+
+                    Display(context, "Open Tracker", frame_draw);
+                }
+
+                LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name
+                                                           << "] Detected face does not meet initial quality: " << first_face_confidence);
+            }
+
+            if (use_face) {
+                //if the face meets quality or we don't care about quality
+                //the keypoints can now be detected
+
+                vector <KeyPoint> keypoints;
+                //search for keypoints within the face
+                DetectFaceKeypoints(context, gray, faces[i].first, keypoints);
+
+                //min init point count should be different for each detector!
+                if(keypoints.size() < context.min_init_point_count)
+                {
+                    LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name << "] Not enough initial points: "
+                                                               << static_cast<int>(keypoints.size()));
+
+                    if(context.imshow_on) {
+                        //draw the track detection red for bad point count
+                        rectangle(frame_draw, face, Scalar(0, 0, 255), 3);
+
+                        Display(context, "Open Tracker", frame_draw);
+                    }
+
+                    continue;
+                }
+
+                //calcOpticalFlowPyrLK uses float points - no need to store the KeyPoint vector - convert
+                KeyPoint::convert(keypoints, track_new.current_points);
+
+                //drawing new points and detection rectangle
+                //image will already contain previously drawn objects
+                if(context.imshow_on) {
+                    for(unsigned k=0; k<track_new.current_points.size(); k++) //TODO: could also use the err vector (from calcOpticalFlowPyrLK) with a float threshold
+                    {
+                        circle(frame_draw, track_new.current_points[k], 2, Scalar(0, 255, 255), CV_FILLED);
+                    }
+
+                    Display(context, "Open Tracker", frame_draw);
+                }
+
+                //set start frame and initial point count
+                track_new.face_track.start_frame = frame_index;
+                //set first face detection index
+                track_new.last_face_detected_index = frame_index;
+                track_new.init_point_count = static_cast<int>(track_new.current_points.size());
+
+                //set face detection
+                Rect face(faces[i].first);
+                AdjustRectToEdges(face, gray);
+                MPFImageLocation first_face_detection(face.x, face.y, face.width, face.height);
+                //first_face_confidence is already a float value
+                first_face_detection.confidence = first_face_confidence;
+
+                //add the first detection
+                track_new.face_track.frame_locations.insert(pair<int, MPFImageLocation>(frame_index, first_face_detection));
+                track_new.face_track.confidence = std::max(track_new.face_track.confidence,
+                                                           first_face_detection.confidence);
+                //add the new track
+                context.current_tracks.push_back(std::move(track_new));
+
+                LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name << "] Creating new track");
+            }
+
+
+        }
+
+    }
+
+    vector <Track> tracks_to_keep;
+    for(vector<Track>::iterator track = context.current_tracks.begin(); track != context.current_tracks.end(); ++track)
+    {
+        if(track->track_lost)
+        {
+            LOG4CXX_TRACE(OpenFaceDetectionLogger, "[" << job_name << "] Killing track");
+            context.track_lost_on_previous_frame = true;
+
+            //did not pass the rules to continue this frame_index, it ended on the previous index
+            track->face_track.stop_frame = frame_index - 1;
+
+            //only saving tracks lasting more than 1 frame to eliminate badly started tracks
+            if (track->face_track.stop_frame - track->face_track.start_frame > 1) {
+                context.saved_tracks.push_back(std::move(*track));
+            }
+        }
+        else {
+            tracks_to_keep.push_back(std::move(*track));
+        }
+    }
+
+    //now replace the current tracks with the tracks to keep
+    context.current_tracks = std::move(tracks_to_keep);
+
+    //set previous frame - a copy is only needed when the gray frame shares the buffer of the frame that will be
+    //overwritten by the next read
+    if (gray.data == frame.data) {
+        context.prev_gray = gray.clone();
+    }
+    else {
+        context.prev_gray = gray;
+    }
+    //the tracks that were just created do not have previous points, so the context.pyramid may not have been built
+    //for this frame yet
+    if (!context.current_tracks.empty()) {
+        if (all_previous_points.empty()) {
+            buildOpticalFlowPyramid(gray, context.pyramid, optical_flow_win_size, optical_flow_max_level);
+        }
+        swap(context.pyramid, context.prev_pyramid);
+    }
+    //swap points
+    for (vector<Track>::iterator it = context.current_tracks.begin(); it != context.current_tracks.end(); it++) {
+        swap(it->current_points, it->previous_points);
+    }
+}
@@ -0,0 +1,178 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2020 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2020 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+
+#ifndef OPENMPF_COMPONENTS_OCVFACETRACKER_H
+#define OPENMPF_COMPONENTS_OCVFACETRACKER_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QHash>
+#include <QString>
+
+#include <opencv2/features2d.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <opencv2/highgui.hpp>
+
+#include <MPFDetectionObjects.h>
+
+#include <log4cxx/logger.h>
+
+#include "OcvDetection.h"
+
+
+
+struct Track {
+    MPF::COMPONENT::MPFVideoTrack face_track;
+    int init_point_count;
+    int current_point_count;
+    float current_point_percent;
+    int last_face_detected_index;
+    bool track_lost;
+    std::vector <cv::Point2f> previous_points;
+    std::vector <cv::Point2f> current_points;
+
+    Track() : init_point_count(0), current_point_count(0), current_point_percent(0.0), last_face_detected_index(-1),
+            track_lost(false) { }
+};
+
+//the settings and tracks of a single job - the component itself only holds what is shared by all jobs, so more than
+//one job can be run at the same time
+struct OcvFaceJobContext {
+    int max_features;
+    cv::Ptr <cv::FeatureDetector> feature_detector;
+
+    bool imshow_on;
+    int verbosity;
+
+    int min_face_size; //the width and height of min size for detection
+    int detection_max_frame_dimension; //frames larger than this are downscaled before detection, 0 to disable
+    int detection_frame_interval; //faces are detected every detection_frame_interval frames
+    std::string detector_type; //CASCADE or DNN
+    int dnn_input_size; //the largest dimension of the frame passed to the dnn
+    float dnn_min_confidence;
+    unsigned int min_init_point_count;
+    float min_redetect_point_perecent;
+    float min_point_percent;
+    float max_optical_flow_error;
+    float min_initial_confidence;
+
+    //TODO: add to config file
+    //when a face is not detected - this is the minimum percentage of features detected compared to initial point count
+    //if below this the track should not continue
+    float min_good_match_percent;
+
+    std::vector <Track> current_tracks;
+    std::vector <Track> saved_tracks;
+
+    //carried from one frame to the next
+    cv::Mat prev_gray;
+    //the pyramids are built once per frame and shared by all of the tracks
+    std::vector <cv::Mat> pyramid;
+    std::vector <cv::Mat> prev_pyramid;
+    //faces are detected on the first frame and then every detection_frame_interval frames - the tracks are moved
+    //along with their optical flow points in between, and detection is forced on the frame after a track is lost
+    int frames_until_detection;
+    bool track_lost_on_previous_frame;
+    //the number of frames that faces were detected on
+    int detection_frame_count;
+
+    //only the detector for detector_type is checked out - it is returned to the OcvDetection pool with the context
+    OcvDetection::CascadePtr face_cascade;
+    OcvDetection::DnnNetPtr dnn_face_net;
+
+    OcvFaceJobContext() : frames_until_detection(0), track_lost_on_previous_frame(false), detection_frame_count(0) { }
+};
+
+//detects and tracks the faces of a job one frame at a time - shared by the batch and streaming components, which
+//each hold one of these and keep a context per job
+class OcvFaceTracker {
+
+public:
+    //loads the face detectors and the mpfOcvFaceDetection.ini config from plugin_path - log4cxx must already be
+    //configured
+    bool Init(std::string &plugin_path);
+
+    void SetModes(bool display_window, bool print_debug_info);
+
+    bool IsImshowOn() const;
+
+    //sets up a job with the config parameters and the job properties, and checks out its face detector
+    void InitJobContext(const std::map <std::string, std::string> &algorithm_properties,
+                        OcvFaceJobContext &context);
+
+    void TrackFrame(OcvFaceJobContext &context, const cv::Mat &frame, int frame_index, const std::string &job_name);
+
+    void CloseAnyOpenTracks(OcvFaceJobContext &context, int frame_index);
+
+    std::vector<std::pair<cv::Rect, int>> DetectFacesInImage(const OcvFaceJobContext &context, const cv::Mat &image,
+                                                             const cv::Mat &image_gray);
+
+    void AdjustRectToEdges(cv::Rect &rect, const cv::Mat &src);
+
+private:
+    OcvDetection ocv_detection;
+
+    //the parameters read from the config file at initialization
+    QHash <QString, QString> parameters;
+
+    log4cxx::LoggerPtr OpenFaceDetectionLogger;
+
+    void SetDefaultParameters(OcvFaceJobContext &context);
+    void SetReadConfigParameters(OcvFaceJobContext &context);
+    void GetPropertySettings(const std::map <std::string, std::string> &algorithm_properties,
+                             OcvFaceJobContext &context);
+    void CheckoutDetector(OcvFaceJobContext &context);
+
+    std::vector<std::pair<cv::Rect, int>> DetectFaces(const OcvFaceJobContext &context, const cv::Mat &frame,
+                                                      const cv::Mat &frame_gray);
+
+    void Display(const OcvFaceJobContext &context, const std::string title, const cv::Mat &img);
+
+    cv::Rect GetMatch(const cv::Mat &frame_gray, const cv::Mat &templ, const cv::Rect &search_rect);
+
+    bool IsExistingTrackIntersection(const OcvFaceJobContext &context, const cv::Rect new_rect,
+                                     int &intersection_index);
+
+    cv::Rect GetUpscaledFaceRect(const cv::Rect &face_rect);
+    cv::Mat GetMask(const cv::Mat &frame, const cv::Rect &face, cv::Rect &mask_rect, bool copy_face_rect = false);
+    void DetectFaceKeypoints(const OcvFaceJobContext &context, const cv::Mat &frame_gray, const cv::Rect &face_rect,
+                             std::vector<cv::KeyPoint> &keypoints);
+
+    void UpdateTrack(const OcvFaceJobContext &context, Track &track, const std::vector<cv::Point2f> &new_points,
+                     const std::vector<uchar> &status, const std::vector<std::pair<cv::Rect, int>> &faces,
+                     bool detect_faces, const cv::Mat &gray, const cv::Mat &prev_gray, int frame_index,
+                     const std::string &job_name, cv::Mat &frame_draw);
+
+    bool IsBadFaceRatio(const cv::Rect &face);
+};
+
+
+#endif //OPENMPF_COMPONENTS_OCVFACETRACKER_H
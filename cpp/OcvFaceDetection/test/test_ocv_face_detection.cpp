@@ -25,10 +25,17 @@
  ******************************************************************************/
 
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <unistd.h>
+
 #include <gtest/gtest.h>
 #include <MPFDetectionComponent.h>
 #include <QDir>
@@ -41,6 +48,8 @@
 #include <ImageGeneration.h>
 
 #include "OcvFaceDetection.h"
+#include "OcvFaceTracker.h"
+#include "OcvFaceStreamingDetection.h"
 
 
 using std::pair;
@@ -124,7 +133,8 @@ TEST(OcvFaceDetection, VerifyQuality) {
     ASSERT_TRUE(!image.empty());
 
     cv::Mat image_gray = Utils::ConvertToGray(image);
-    vector<pair<cv::Rect,int>> face_rects = ocv_detection->DetectFaces(image_gray, 10);
+    vector<pair<cv::Rect,int>> face_rects = ocv_detection->DetectFaces(*ocv_detection->CheckoutCascade(),
+                                                                       image_gray, 10);
     ASSERT_TRUE(face_rects.size() == 1);
 
     float detection_confidence = static_cast<float>(face_rects[0].second);
@@ -217,6 +227,468 @@ TEST(VideoGeneration, TestOnKnownVideo) {
     delete ocv_face_detection;
 }
 
+// Runs the tracker over the frames of a video and returns the number of frames that faces were detected on.
+static int CountDetectionFrames(OcvFaceTracker &tracker, const MPFVideoJob &job) {
+    OcvFaceJobContext context;
+    tracker.InitJobContext(job.job_properties, context);
+
+    MPFVideoCapture video_capture(job);
+    cv::Mat frame;
+    int frame_index = 0;
+    while (video_capture.Read(frame)) {
+        tracker.TrackFrame(context, frame, frame_index, job.job_name);
+        ++frame_index;
+    }
+    return context.detection_frame_count;
+}
+
+TEST(VideoGeneration, TestDetectionFrameInterval) {
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        string config_path(current_path.toStdString() + "/config/test_ocv_face_config.ini");
+        std::cout << "config path: " << config_path << std::endl;
+        int rc = LoadConfig(config_path, parameters);
+        ASSERT_EQ(0, rc);
+        std::cout << "Test TestDetectionFrameInterval: config file loaded" << std::endl;
+        parameters_loaded = true;
+    }
+
+    int start = parameters["OCV_FACE_START_FRAME"].toInt();
+    int stop = parameters["OCV_FACE_STOP_FRAME"].toInt();
+    string inTrackFile = parameters["OCV_FACE_KNOWN_TRACKS"].toStdString();
+    string inVideoFile = parameters["OCV_FACE_VIDEO_FILE"].toStdString();
+    float comparison_score_threshold = parameters["OCV_FACE_COMPARISON_SCORE_VIDEO"].toFloat();
+
+    // 	With the default interval faces are detected on every frame. With an interval of 5 they are only detected
+    // 	on every fifth frame and on the frames after a track is lost.
+    OcvFaceTracker tracker;
+    string plugin_path = current_working_dir + "/../plugin/OcvFaceDetection";
+    ASSERT_TRUE(tracker.Init(plugin_path));
+
+    int num_frames = stop - start + 1;
+    int every_frame_count = CountDetectionFrames(tracker, MPFVideoJob("Testing", inVideoFile, start, stop, { }, { }));
+    int interval_count = CountDetectionFrames(
+            tracker, MPFVideoJob("Testing", inVideoFile, start, stop, { {"DETECTION_FRAME_INTERVAL", "5"} }, { }));
+    std::cout << "Faces detected on " << every_frame_count << " frames without an interval and on "
+              << interval_count << " frames with an interval of 5." << std::endl;
+    EXPECT_EQ(num_frames, every_frame_count);
+    EXPECT_GE(interval_count, num_frames / 5);
+    EXPECT_LT(interval_count, num_frames / 2);
+
+    // 	The tracks should still match the known tracks and have a face on every frame.
+    vector<MPFVideoTrack> known_tracks;
+    ASSERT_TRUE(ReadDetectionsFromFile::ReadVideoTracks(inTrackFile, known_tracks));
+
+    OcvFaceDetection *ocv_face_detection = new OcvFaceDetection();
+    ASSERT_TRUE(NULL != ocv_face_detection);
+    ocv_face_detection->SetRunDirectory(current_working_dir + "/../plugin");
+    ASSERT_TRUE(ocv_face_detection->Init());
+
+    MPFVideoJob videoJob("Testing", inVideoFile, start, stop, { {"DETECTION_FRAME_INTERVAL", "5"} }, { });
+    vector<MPFVideoTrack> found_tracks = ocv_face_detection->GetDetections(videoJob);
+    ASSERT_FALSE(found_tracks.empty());
+
+    float comparison_score = DetectionComparison::CompareDetectionOutput(found_tracks, known_tracks);
+    std::cout << "Tracker comparison score with an interval of 5: " << comparison_score << std::endl;
+    EXPECT_GT(comparison_score, comparison_score_threshold);
+
+    // 	Faces that were only moved along with their points have a confidence of 0.
+    int undetected_face_count = 0;
+    for (const MPFVideoTrack &track : found_tracks) {
+        EXPECT_EQ(static_cast<size_t>(track.stop_frame - track.start_frame + 1), track.frame_locations.size());
+        for (const auto &frame_location : track.frame_locations) {
+            if (frame_location.second.confidence == 0) {
+                undetected_face_count++;
+            }
+        }
+    }
+    EXPECT_GT(undetected_face_count, 0);
+
+    EXPECT_TRUE(ocv_face_detection->Close());
+    delete ocv_face_detection;
+}
+
+TEST(VideoGeneration, TestDetectionMaxFrameDimension) {
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        string config_path(current_path.toStdString() + "/config/test_ocv_face_config.ini");
+        std::cout << "config path: " << config_path << std::endl;
+        int rc = LoadConfig(config_path, parameters);
+        ASSERT_EQ(0, rc);
+        std::cout << "Test TestDetectionMaxFrameDimension: config file loaded" << std::endl;
+        parameters_loaded = true;
+    }
+
+    // 	A face detected on a downscaled image must be scaled back to the same place as on the full size image.
+    string plugins_dir = current_working_dir + "/../plugin/OcvFaceDetection";
+    OcvDetection ocv_detection;
+    ASSERT_TRUE(ocv_detection.Init(plugins_dir));
+
+    string test_image_path = parameters["OCV_FACE_1_FILE"].toStdString();
+    if(test_image_path.find_first_of('.') == 0) {
+        test_image_path = current_working_dir + "/" + test_image_path;
+    }
+    cv::Mat image = cv::imread(test_image_path, CV_LOAD_IMAGE_IGNORE_ORIENTATION + CV_LOAD_IMAGE_COLOR);
+    ASSERT_TRUE(!image.empty());
+    cv::Mat image_gray = Utils::ConvertToGray(image);
+    int max_frame_dimension = std::max(image.cols, image.rows) / 2;
+
+    vector<pair<cv::Rect,int>> full_size_faces;
+    vector<pair<cv::Rect,int>> downscaled_faces;
+    {
+        OcvDetection::CascadePtr face_cascade = ocv_detection.CheckoutCascade();
+        full_size_faces = ocv_detection.DetectFaces(*face_cascade, image_gray, 10);
+        downscaled_faces = ocv_detection.DetectFaces(*face_cascade, image_gray, 10, max_frame_dimension);
+    }
+    ASSERT_EQ(1u, full_size_faces.size());
+    ASSERT_EQ(1u, downscaled_faces.size());
+    cv::Rect full_size_face = full_size_faces[0].first;
+    cv::Rect downscaled_face = downscaled_faces[0].first;
+    std::cout << "Full size face: " << full_size_face << ", downscaled face: " << downscaled_face << std::endl;
+    EXPECT_GT((full_size_face & downscaled_face).area(), 0.5 * (full_size_face | downscaled_face).area());
+
+    // 	The tracks found on the downscaled frames of the video should still match the known tracks.
+    int start = parameters["OCV_FACE_START_FRAME"].toInt();
+    int stop = parameters["OCV_FACE_STOP_FRAME"].toInt();
+    string inTrackFile = parameters["OCV_FACE_KNOWN_TRACKS"].toStdString();
+    string inVideoFile = parameters["OCV_FACE_VIDEO_FILE"].toStdString();
+    float comparison_score_threshold = parameters["OCV_FACE_COMPARISON_SCORE_VIDEO"].toFloat();
+
+    vector<MPFVideoTrack> known_tracks;
+    ASSERT_TRUE(ReadDetectionsFromFile::ReadVideoTracks(inTrackFile, known_tracks));
+
+    cv::Size frame_size = MPFVideoCapture(MPFVideoJob("Testing", inVideoFile, start, stop, { }, { })).GetFrameSize();
+    string video_max_frame_dimension = std::to_string(3 * std::max(frame_size.width, frame_size.height) / 4);
+
+    OcvFaceDetection *ocv_face_detection = new OcvFaceDetection();
+    ASSERT_TRUE(NULL != ocv_face_detection);
+    ocv_face_detection->SetRunDirectory(current_working_dir + "/../plugin");
+    ASSERT_TRUE(ocv_face_detection->Init());
+
+    MPFVideoJob videoJob("Testing", inVideoFile, start, stop,
+                         { {"DETECTION_MAX_FRAME_DIMENSION", video_max_frame_dimension} }, { });
+    vector<MPFVideoTrack> found_tracks = ocv_face_detection->GetDetections(videoJob);
+    ASSERT_FALSE(found_tracks.empty());
+
+    float comparison_score = DetectionComparison::CompareDetectionOutput(found_tracks, known_tracks);
+    std::cout << "Tracker comparison score with a max frame dimension of " << video_max_frame_dimension << ": "
+              << comparison_score << std::endl;
+    EXPECT_GT(comparison_score, comparison_score_threshold);
+
+    EXPECT_TRUE(ocv_face_detection->Close());
+    delete ocv_face_detection;
+}
+
+static void ExpectSameTracks(const vector<MPFVideoTrack> &expected_tracks, const vector<MPFVideoTrack> &tracks) {
+    ASSERT_EQ(expected_tracks.size(), tracks.size());
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const MPFVideoTrack &expected = expected_tracks[i];
+        const MPFVideoTrack &track = tracks[i];
+        EXPECT_EQ(expected.start_frame, track.start_frame) << "track " << i;
+        EXPECT_EQ(expected.stop_frame, track.stop_frame) << "track " << i;
+        EXPECT_EQ(expected.confidence, track.confidence) << "track " << i;
+        ASSERT_EQ(expected.frame_locations.size(), track.frame_locations.size()) << "track " << i;
+        for (const auto &expected_location : expected.frame_locations) {
+            auto location = track.frame_locations.find(expected_location.first);
+            ASSERT_TRUE(location != track.frame_locations.end())
+                    << "track " << i << ", frame " << expected_location.first;
+            EXPECT_EQ(Utils::ImageLocationToCvRect(expected_location.second),
+                      Utils::ImageLocationToCvRect(location->second))
+                    << "track " << i << ", frame " << expected_location.first;
+            EXPECT_EQ(expected_location.second.confidence, location->second.confidence)
+                    << "track " << i << ", frame " << expected_location.first;
+        }
+    }
+}
+
+// Writes a video where each frame is a frame of the known video with the face of the first known track next to the
+// matching frame of the second known track, so that two faces are tracked at the same time.
+static void WriteTwoFaceVideo(const string &in_video_file, const vector<MPFVideoTrack> &known_tracks,
+                              const string &out_video_file, int &frame_count) {
+    ASSERT_GE(known_tracks.size(), 2u);
+    const MPFVideoTrack &first_track = known_tracks[0];
+    const MPFVideoTrack &second_track = known_tracks[1];
+    int offset = second_track.start_frame - first_track.start_frame;
+
+    cv::VideoCapture cap(in_video_file);
+    ASSERT_TRUE(cap.isOpened());
+    vector<cv::Mat> frames;
+    cv::Mat frame;
+    while (cap.read(frame)) {
+        frames.push_back(frame.clone());
+    }
+
+    int last_frame = std::min(first_track.stop_frame, static_cast<int>(frames.size()) - 1 - offset);
+    ASSERT_GT(last_frame, first_track.start_frame);
+    cv::Size frame_size(2 * frames[0].cols, frames[0].rows);
+    cv::VideoWriter writer(out_video_file, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 10, frame_size);
+    ASSERT_TRUE(writer.isOpened());
+    frame_count = 0;
+    for (int i = first_track.start_frame; i <= last_frame; i++) {
+        cv::Mat two_face_frame;
+        cv::hconcat(frames[i], frames[i + offset], two_face_frame);
+        writer.write(two_face_frame);
+        frame_count++;
+    }
+}
+
+// The tracks are updated in parallel - updating them one at a time must give exactly the same tracks.
+TEST(VideoGeneration, TestParallelTrackUpdate) {
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        string config_path(current_path.toStdString() + "/config/test_ocv_face_config.ini");
+        std::cout << "config path: " << config_path << std::endl;
+        int rc = LoadConfig(config_path, parameters);
+        ASSERT_EQ(0, rc);
+        std::cout << "Test TestParallelTrackUpdate: config file loaded" << std::endl;
+        parameters_loaded = true;
+    }
+
+    string inTrackFile = parameters["OCV_FACE_KNOWN_TRACKS"].toStdString();
+    string inVideoFile = parameters["OCV_FACE_VIDEO_FILE"].toStdString();
+
+    vector<MPFVideoTrack> known_tracks;
+    ASSERT_TRUE(ReadDetectionsFromFile::ReadVideoTracks(inTrackFile, known_tracks));
+
+    // 	The known video only shows one face at a time, which would leave a single track in each parallel update.
+    char dir_template[] = "/tmp/ocv_face_test-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir_template) != NULL);
+    string temp_dir(dir_template);
+    string two_face_video_file = temp_dir + "/two_faces.avi";
+    int frame_count = 0;
+    ASSERT_NO_FATAL_FAILURE(WriteTwoFaceVideo(inVideoFile, known_tracks, two_face_video_file, frame_count));
+
+    OcvFaceDetection *ocv_face_detection = new OcvFaceDetection();
+    ASSERT_TRUE(NULL != ocv_face_detection);
+    ocv_face_detection->SetRunDirectory(current_working_dir + "/../plugin");
+    ASSERT_TRUE(ocv_face_detection->Init());
+
+    MPFVideoJob videoJob("Testing", two_face_video_file, 0, frame_count - 1, { }, { });
+    vector<MPFVideoTrack> parallel_tracks = ocv_face_detection->GetDetections(videoJob);
+
+    bool found_overlapping_tracks = false;
+    for (size_t i = 0; i < parallel_tracks.size(); i++) {
+        for (size_t j = i + 1; j < parallel_tracks.size(); j++) {
+            if (parallel_tracks[i].start_frame <= parallel_tracks[j].stop_frame
+                    && parallel_tracks[j].start_frame <= parallel_tracks[i].stop_frame) {
+                found_overlapping_tracks = true;
+            }
+        }
+    }
+    EXPECT_TRUE(found_overlapping_tracks);
+
+    // 	cv::parallel_for_ runs the whole range on the calling thread when OpenCV is limited to one thread.
+    int num_threads = cv::getNumThreads();
+    cv::setNumThreads(1);
+    vector<MPFVideoTrack> serial_tracks;
+    try {
+        serial_tracks = ocv_face_detection->GetDetections(videoJob);
+    }
+    catch (...) {
+        cv::setNumThreads(num_threads);
+        throw;
+    }
+    cv::setNumThreads(num_threads);
+
+    ExpectSameTracks(serial_tracks, parallel_tracks);
+
+    std::remove(two_face_video_file.c_str());
+    rmdir(temp_dir.c_str());
+
+    EXPECT_TRUE(ocv_face_detection->Close());
+    delete ocv_face_detection;
+}
+
+// Runs the known video with each face detector and reports the frame rate and the comparison score against the
+// known tracks, which is used as the recall of the detector.
+// Returns the number of hand-annotated faces in ground_truth_faces that overlap one of the found faces with an
+// intersection over union of at least 0.5. Each found face can only match one annotated face.
+static int CountMatchedFaces(const vector<MPFImageLocation> &found_faces,
+                             const vector<MPFImageLocation> &ground_truth_faces) {
+    vector<bool> used(found_faces.size(), false);
+    int matched_count = 0;
+    for (const MPFImageLocation &truth : ground_truth_faces) {
+        cv::Rect truth_rect(truth.x_left_upper, truth.y_left_upper, truth.width, truth.height);
+        for (size_t i = 0; i < found_faces.size(); i++) {
+            cv::Rect found_rect(found_faces[i].x_left_upper, found_faces[i].y_left_upper,
+                                found_faces[i].width, found_faces[i].height);
+            double intersection = (truth_rect & found_rect).area();
+            double iou = intersection / (truth_rect.area() + found_rect.area() - intersection);
+            if (!used[i] && iou >= 0.5) {
+                used[i] = true;
+                matched_count++;
+                break;
+            }
+        }
+    }
+    return matched_count;
+}
+
+// This test measures the recall of both detectors against hand-annotated face boxes in the test images, and
+// prints the frame rate of each detector on the test video. The known video tracks were produced by the cascade, so
+// the video score only shows how closely the DNN detector agrees with the cascade.
+TEST(VideoGeneration, CompareCascadeAndDnnDetectors) {
+    string current_working_dir = GetCurrentWorkingDirectory();
+    string plugin_dir = current_working_dir + "/../plugin";
+
+    if (!std::ifstream(plugin_dir + "/OcvFaceDetection/data/res10_300x300_ssd_iter_140000.caffemodel").good()) {
+        GTEST_SKIP() << "The DNN face model is not installed.";
+    }
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        string config_path(current_path.toStdString() + "/config/test_ocv_face_config.ini");
+        std::cout << "config path: " << config_path << std::endl;
+        int rc = LoadConfig(config_path, parameters);
+        ASSERT_EQ(0, rc);
+        std::cout << "Test CompareCascadeAndDnnDetectors: config file loaded" << std::endl;
+        parameters_loaded = true;
+    }
+
+    int start = parameters["OCV_FACE_START_FRAME"].toInt();
+    int stop = parameters["OCV_FACE_STOP_FRAME"].toInt();
+    string inTrackFile = parameters["OCV_FACE_KNOWN_TRACKS"].toStdString();
+    string inVideoFile = parameters["OCV_FACE_VIDEO_FILE"].toStdString();
+    float recall_threshold = parameters["OCV_FACE_GROUND_TRUTH_RECALL"].toFloat();
+
+    // 	Each test image is paired with a file holding one hand-annotated face box per line.
+    vector<pair<string, string>> annotated_images = {
+        { "./test/test_imgs/S001-01-t10_01.jpg", "./test/test_imgs/S001-01-t10_01_ground_truth.txt" },
+        { "./test/test_imgs/S008-01-t10_01.jpg", "./test/test_imgs/S008-01-t10_01_ground_truth.txt" },
+        { "./test/test_imgs/meds_faces_image.png", "./test/test_imgs/meds_faces_image_ground_truth.txt" }
+    };
+
+    vector<MPFVideoTrack> known_tracks;
+    ASSERT_TRUE(ReadDetectionsFromFile::ReadVideoTracks(inTrackFile, known_tracks));
+
+    OcvFaceDetection *ocv_face_detection = new OcvFaceDetection();
+    ASSERT_TRUE(NULL != ocv_face_detection);
+    ocv_face_detection->SetRunDirectory(plugin_dir);
+    ASSERT_TRUE(ocv_face_detection->Init());
+
+    for (const string &detector_type : { "CASCADE", "DNN" }) {
+        int face_count = 0;
+        int matched_count = 0;
+        for (const auto &annotated_image : annotated_images) {
+            vector<MPFImageLocation> ground_truth_faces;
+            ASSERT_TRUE(ReadDetectionsFromFile::ReadImageLocations(annotated_image.second, ground_truth_faces));
+
+            MPFImageJob image_job("Testing", annotated_image.first, { {"DETECTOR_TYPE", detector_type} }, { });
+            vector<MPFImageLocation> found_faces = ocv_face_detection->GetDetections(image_job);
+
+            face_count += ground_truth_faces.size();
+            matched_count += CountMatchedFaces(found_faces, ground_truth_faces);
+        }
+        float recall = static_cast<float>(matched_count) / face_count;
+
+        MPFVideoJob videoJob("Testing", inVideoFile, start, stop, { {"DETECTOR_TYPE", detector_type} }, { });
+
+        auto start_time = std::chrono::steady_clock::now();
+        vector<MPFVideoTrack> found_tracks = ocv_face_detection->GetDetections(videoJob);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+        float agreement_score = DetectionComparison::CompareDetectionOutput(found_tracks, known_tracks);
+        std::cout << detector_type << " detector: recall " << matched_count << "/" << face_count << ", "
+                  << (stop - start + 1) / elapsed.count() << " fps, "
+                  << "agreement with the cascade reference tracks: " << agreement_score << std::endl;
+        EXPECT_GE(recall, recall_threshold) << detector_type;
+    }
+
+    EXPECT_TRUE(ocv_face_detection->Close());
+    delete ocv_face_detection;
+}
+
+TEST(VideoGeneration, TestInvalidDetectorType) {
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    OcvFaceDetection *ocv_face_detection = new OcvFaceDetection();
+    ASSERT_TRUE(NULL != ocv_face_detection);
+    ocv_face_detection->SetRunDirectory(current_working_dir + "/../plugin");
+    ASSERT_TRUE(ocv_face_detection->Init());
+
+    MPFVideoJob videoJob("Testing", "./test/test_vids/new_face_video.avi", 0, 1, { {"DETECTOR_TYPE", "HAAR"} }, { });
+    try {
+        ocv_face_detection->GetDetections(videoJob);
+        FAIL() << "Expected exception not thrown.";
+    }
+    catch (const MPFDetectionException &ex) {
+        EXPECT_EQ(MPF_INVALID_PROPERTY, ex.error_code);
+    }
+
+    EXPECT_TRUE(ocv_face_detection->Close());
+    delete ocv_face_detection;
+}
+
+TEST(OcvFaceStreaming, VideoTest) {
+    string current_working_dir = GetCurrentWorkingDirectory();
+
+    if (!parameters_loaded) {
+        QString current_path = QDir::currentPath();
+        string config_path(current_path.toStdString() + "/config/test_ocv_face_config.ini");
+        std::cout << "config path: " << config_path << std::endl;
+        int rc = LoadConfig(config_path, parameters);
+        ASSERT_EQ(0, rc);
+        std::cout << "Test OcvFaceStreaming VideoTest: config file loaded" << std::endl;
+        parameters_loaded = true;
+    }
+
+    int stop = parameters["OCV_FACE_STOP_FRAME"].toInt();
+    string inVideoFile = parameters["OCV_FACE_VIDEO_FILE"].toStdString();
+
+    MPFStreamingVideoJob job("Test", current_working_dir + "/../plugin", { }, { });
+    OcvFaceStreamingDetection component(job);
+
+    // The video is split into two segments. A face that is visible at the end of the first segment is still being
+    // tracked at the start of the second segment.
+    MPFVideoCapture cap({"Test", inVideoFile, 0, stop, { }, { }});
+    int segment_size = (stop + 1) / 2;
+    int frame_number = 0;
+    cv::Mat frame;
+    bool found_continued_track = false;
+    for (int segment = 0; segment < 2; segment++) {
+        VideoSegmentInfo segment_info(segment, frame_number, frame_number + segment_size - 1, 100, 100);
+        component.BeginSegment(segment_info);
+
+        int true_count = 0;
+        int first_detection_frame = -1;
+        while (frame_number <= segment_info.end_frame && cap.Read(frame)) {
+            if (component.ProcessFrame(frame, frame_number)) {
+                true_count++;
+                first_detection_frame = frame_number;
+            }
+            frame_number++;
+        }
+        ASSERT_EQ(1, true_count);
+
+        vector<MPFVideoTrack> tracks = component.EndSegment();
+        ASSERT_FALSE(tracks.empty());
+        // The track that caused ProcessFrame to return true must be one of the reported tracks.
+        bool found_reported_detection = false;
+        for (const MPFVideoTrack &track : tracks) {
+            if (track.start_frame <= first_detection_frame && track.stop_frame >= first_detection_frame) {
+                found_reported_detection = true;
+            }
+        }
+        EXPECT_TRUE(found_reported_detection);
+        for (const MPFVideoTrack &track : tracks) {
+            ASSERT_FALSE(track.frame_locations.empty());
+            EXPECT_GE(track.start_frame, segment_info.start_frame);
+            EXPECT_LE(track.stop_frame, segment_info.end_frame);
+            EXPECT_EQ(track.start_frame, track.frame_locations.begin()->first);
+            if (segment > 0 && track.start_frame == segment_info.start_frame) {
+                found_continued_track = true;
+            }
+        }
+    }
+    EXPECT_TRUE(found_continued_track);
+}
+
 TEST(ImageGeneration, TestOnKnownImage) {
     string current_working_dir = GetCurrentWorkingDirectory();
     string test_output_dir = current_working_dir + "/test/test_output/";